@@ -0,0 +1,326 @@
+// Measures zip extraction throughput on synthetic
+// archives: lots of small files, a few huge ones,
+// stored and deflated entries, and deep trees.
+// Every scenario runs in a process of its own, as
+// the peak RSS of a process never goes back down
+
+#include "../src/Zip.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+struct BenchFile {
+    std::string m_name;
+    size_t m_size;
+};
+
+struct Scenario {
+    std::string m_name;
+    std::vector<BenchFile> m_files;
+    bool m_deflate;
+};
+
+static void write16(std::ostream& out, uint16_t value) {
+    char bytes[] = { char(value), char(value >> 8) };
+    out.write(bytes, 2);
+}
+
+static void write32(std::ostream& out, uint32_t value) {
+    write16(out, uint16_t(value));
+    write16(out, uint16_t(value >> 16));
+}
+
+// somewhat compressible, like binaries and text are
+static void makeContents(std::vector<uint8_t>& data, std::mt19937& rng) {
+    size_t i = 0;
+    while (i < data.size()) {
+        auto run = std::min<size_t>(data.size() - i, 16 + rng() % 64);
+        if (rng() % 2) {
+            for (size_t j = 0; j < run; j++) data[i + j] = uint8_t(rng());
+        } else {
+            auto byte = uint8_t(rng() % 8);
+            for (size_t j = 0; j < run; j++) data[i + j] = byte + uint8_t(j % 4);
+        }
+        i += run;
+    }
+}
+
+// writes a plain (non-zip64) archive, so every
+// scenario has to stay under 4 GiB. Contents are
+// generated in chunks to keep the memory use of
+// the generator out of the peak RSS
+static uint64_t writeZip(ghc::filesystem::path const& path, Scenario const& scenario) {
+    std::ofstream out(path, std::ios::binary);
+    std::mt19937 rng(1234);
+    struct Record {
+        std::string m_name;
+        uint32_t m_crc;
+        uint32_t m_compressed;
+        uint32_t m_uncompressed;
+        uint32_t m_offset;
+    };
+    std::vector<Record> records;
+    std::vector<uint8_t> chunk;
+    std::vector<uint8_t> compressed(1048576 + 1024);
+    uint64_t total = 0;
+    for (auto& file : scenario.m_files) {
+        Record record { file.m_name, 0, 0, 0, static_cast<uint32_t>(out.tellp()) };
+        auto writeHeader = [&]() {
+            write32(out, 0x04034b50);
+            write16(out, 20);
+            write16(out, 0);
+            write16(out, scenario.m_deflate ? 8 : 0);
+            write32(out, 0);
+            write32(out, record.m_crc);
+            write32(out, record.m_compressed);
+            write32(out, record.m_uncompressed);
+            write16(out, static_cast<uint16_t>(file.m_name.size()));
+            write16(out, 0);
+            out << file.m_name;
+        };
+        // the sizes and CRC are filled in afterwards
+        writeHeader();
+
+        z_stream stream = z_stream();
+        deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        auto crc = crc32(0, nullptr, 0);
+        size_t left = file.m_size;
+        do {
+            chunk.resize(std::min<size_t>(left, 1048576));
+            makeContents(chunk, rng);
+            left -= chunk.size();
+            crc = crc32(crc, chunk.data(), static_cast<uInt>(chunk.size()));
+            if (!scenario.m_deflate) {
+                out.write(reinterpret_cast<char const*>(chunk.data()), chunk.size());
+                continue;
+            }
+            stream.next_in = chunk.data();
+            stream.avail_in = static_cast<uInt>(chunk.size());
+            do {
+                stream.next_out = compressed.data();
+                stream.avail_out = static_cast<uInt>(compressed.size());
+                deflate(&stream, left ? Z_NO_FLUSH : Z_FINISH);
+                out.write(
+                    reinterpret_cast<char const*>(compressed.data()),
+                    compressed.size() - stream.avail_out
+                );
+            } while (stream.avail_out == 0);
+        } while (left);
+        deflateEnd(&stream);
+
+        auto end = out.tellp();
+        record.m_crc = static_cast<uint32_t>(crc);
+        record.m_uncompressed = static_cast<uint32_t>(file.m_size);
+        record.m_compressed = scenario.m_deflate ?
+            static_cast<uint32_t>(stream.total_out) :
+            static_cast<uint32_t>(file.m_size);
+        out.seekp(record.m_offset);
+        writeHeader();
+        out.seekp(end);
+
+        records.push_back(record);
+        total += file.m_size;
+    }
+    auto centralStart = static_cast<uint32_t>(out.tellp());
+    for (auto& record : records) {
+        write32(out, 0x02014b50);
+        write16(out, 20);
+        write16(out, 20);
+        write16(out, 0);
+        write16(out, scenario.m_deflate ? 8 : 0);
+        write32(out, 0);
+        write32(out, record.m_crc);
+        write32(out, record.m_compressed);
+        write32(out, record.m_uncompressed);
+        write16(out, static_cast<uint16_t>(record.m_name.size()));
+        write16(out, 0);
+        write16(out, 0);
+        write16(out, 0);
+        write16(out, 0);
+        write32(out, 0);
+        write32(out, record.m_offset);
+        out << record.m_name;
+    }
+    auto centralSize = static_cast<uint32_t>(out.tellp()) - centralStart;
+    write32(out, 0x06054b50);
+    write16(out, 0);
+    write16(out, 0);
+    write16(out, static_cast<uint16_t>(records.size()));
+    write16(out, static_cast<uint16_t>(records.size()));
+    write32(out, centralSize);
+    write32(out, centralStart);
+    write16(out, 0);
+    return total;
+}
+
+static double getPeakRSS() {
+    #ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / 1048576.0;
+    #else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    #ifdef __APPLE__
+    return usage.ru_maxrss / 1048576.0;
+    #else
+    return usage.ru_maxrss / 1024.0;
+    #endif
+    #endif
+}
+
+static std::vector<Scenario> makeScenarios() {
+    std::vector<Scenario> scenarios;
+    for (auto deflate : { false, true }) {
+        auto suffix = deflate ? " (deflated)" : " (stored)";
+
+        Scenario small { std::string("5000 small files") + suffix, {}, deflate };
+        for (size_t i = 0; i < 5000; i++) {
+            small.m_files.push_back({
+                "dir" + std::to_string(i % 50) + "/file" + std::to_string(i) + ".txt",
+                1024 + (i * 7919) % 8192,
+            });
+        }
+        scenarios.push_back(small);
+
+        Scenario huge { std::string("4 huge files") + suffix, {}, deflate };
+        for (size_t i = 0; i < 4; i++) {
+            huge.m_files.push_back({ "huge" + std::to_string(i) + ".bin", 64 * 1048576 });
+        }
+        scenarios.push_back(huge);
+
+        Scenario deep { std::string("deep tree") + suffix, {}, deflate };
+        std::string dir;
+        // short names to stay under MAX_PATH on Windows
+        for (size_t depth = 0; depth < 32; depth++) {
+            dir += "d" + std::to_string(depth) + "/";
+            for (size_t i = 0; i < 20; i++) {
+                deep.m_files.push_back({ dir + "file" + std::to_string(i), 16384 });
+            }
+        }
+        scenarios.push_back(deep);
+    }
+    return scenarios;
+}
+
+static bool parseCount(char const* str, size_t& count) {
+    if (!*str || *str < '0' || *str > '9') {
+        return false;
+    }
+    char* end;
+    errno = 0;
+    auto value = std::strtoull(str, &end, 10);
+    if (*end || errno) {
+        return false;
+    }
+    count = static_cast<size_t>(value);
+    return true;
+}
+
+static int runScenario(
+    Scenario const& scenario,
+    size_t threads,
+    ghc::filesystem::path const& root
+) {
+    std::cout << std::fixed << std::setprecision(1);
+    auto zipPath = root / "bench.zip";
+    auto target = root / "out";
+    auto bytes = writeZip(zipPath, scenario);
+
+    // the second run goes over the extracted tree 
+    // again, like updating to an identical version
+    ZipCrcCache crcCache(root / "crc.json");
+    for (auto again : { false, true }) {
+        auto start = std::chrono::steady_clock::now();
+        auto zip = ZipArchive::open(zipPath);
+        if (!zip) {
+            std::cerr << scenario.m_name << ": " << zip.error() << "\n";
+            return 1;
+        }
+        auto res = zip.value().extractTo(target, threads, &crcCache);
+        if (!res) {
+            std::cerr << scenario.m_name << ": " << res.error() << "\n";
+            return 1;
+        }
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+        std::cout << std::left << std::setw(30)
+            << (again ? "  unchanged" : scenario.m_name)
+            << std::right << std::setw(12) << time.count() * 1000.0;
+        // nothing gets written when the files are
+        // unchanged, so only files checked count
+        if (again) {
+            std::cout << std::setw(12) << "-";
+        } else {
+            std::cout << std::setw(12) << bytes / 1048576.0 / time.count();
+        }
+        std::cout << std::setw(12) << scenario.m_files.size() / time.count()
+            << std::setw(16) << getPeakRSS() << std::endl;
+    }
+    return 0;
+}
+
+static void printUsage(char const* name) {
+    std::cout << "Usage: " << name << " [threads]\n"
+        << "  threads  worker threads to extract with; 0 (default) picks one per core\n";
+}
+
+int main(int argc, char** argv) {
+    auto scenarios = makeScenarios();
+
+    // internal: run one scenario, started by the parent
+    if (argc == 4 && std::string(argv[1]) == "--scenario") {
+        size_t index;
+        size_t threads;
+        if (!parseCount(argv[2], index) || index >= scenarios.size() || !parseCount(argv[3], threads)) {
+            return 1;
+        }
+        auto root = ghc::filesystem::temp_directory_path() /
+            "geode-extract-bench" / std::to_string(index);
+        ghc::filesystem::remove_all(root);
+        ghc::filesystem::create_directories(root);
+        auto res = runScenario(scenarios.at(index), threads, root);
+        ghc::filesystem::remove_all(root);
+        return res;
+    }
+
+    size_t threads = 0;
+    if (argc > 2 || (argc == 2 && !parseCount(argv[1], threads))) {
+        printUsage(argv[0]);
+        auto help = std::string(argv[1]);
+        return help == "-h" || help == "--help" ? 0 : 1;
+    }
+
+    std::cout << std::left << std::setw(30) << "scenario"
+        << std::right << std::setw(12) << "time (ms)"
+        << std::setw(12) << "MB/s"
+        << std::setw(12) << "files/s"
+        << std::setw(16) << "peak RSS (MB)" << std::endl;
+
+    for (size_t i = 0; i < scenarios.size(); i++) {
+        auto command = "\"" + std::string(argv[0]) + "\" --scenario " +
+            std::to_string(i) + " " + std::to_string(threads);
+        #ifdef _WIN32
+        // cmd strips the outer quotes off the command
+        command = "\"" + command + "\"";
+        #endif
+        if (std::system(command.c_str()) != 0) {
+            std::cerr << scenarios.at(i).m_name << ": failed\n";
+            return 1;
+        }
+    }
+
+    ghc::filesystem::remove_all(ghc::filesystem::temp_directory_path() / "geode-extract-bench");
+    return 0;
+}
@@ -0,0 +1,103 @@
+// Compares parseRelease against parsing the whole
+// release document into a DOM, on a synthetic
+// GitHub release with lots of assets and long
+// release notes
+
+#include "../src/ReleaseInfo.hpp"
+#include "../src/include/json.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static std::string makeRelease(size_t assetCount, size_t notesSize) {
+    // ordered so the fields come in the same order
+    // as in the responses from the GitHub API
+    nlohmann::ordered_json uploader = {
+        { "login", "geode-sdk-bot" },
+        { "id", 123456 },
+        { "type", "Bot" },
+        { "site_admin", false },
+    };
+    nlohmann::ordered_json release;
+    release["url"] = "https://api.github.com/repos/geode-sdk/cli/releases/1";
+    release["id"] = 1;
+    release["author"] = uploader;
+    release["tag_name"] = "v1.0.0";
+    release["name"] = "Geode CLI v1.0.0";
+    release["draft"] = false;
+    release["prerelease"] = false;
+    release["assets"] = nlohmann::ordered_json::array();
+    for (size_t i = 0; i < assetCount; i++) {
+        auto name = "geode-cli-v1.0.0-platform" + std::to_string(i) + ".zip";
+        release["assets"].push_back({
+            { "url", "https://api.github.com/repos/geode-sdk/cli/releases/assets/" + std::to_string(i) },
+            { "id", i },
+            { "name", name },
+            { "label", nullptr },
+            { "uploader", uploader },
+            { "content_type", "application/zip" },
+            { "state", "uploaded" },
+            { "size", 4096 * i },
+            { "download_count", 1000 + i },
+            { "browser_download_url", "https://github.com/geode-sdk/cli/releases/download/v1.0.0/" + name },
+        });
+    }
+    release["tarball_url"] = "https://api.github.com/repos/geode-sdk/cli/tarball/v1.0.0";
+    release["zipball_url"] = "https://api.github.com/repos/geode-sdk/cli/zipball/v1.0.0";
+    release["body"] = std::string(notesSize, 'x');
+    return release.dump();
+}
+
+template<class Func>
+static double measure(size_t iterations, Func func) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        func();
+    }
+    auto time = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(time).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    size_t assets = argc > 1 ? std::stoul(argv[1]) : 500;
+    size_t notes = argc > 2 ? std::stoul(argv[2]) : 4 * 1024 * 1024;
+    size_t iterations = argc > 3 ? std::stoul(argv[3]) : 20;
+
+    auto path = ghc::filesystem::temp_directory_path() / "geode-release-bench.json";
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        ofs << makeRelease(assets, notes);
+    }
+    auto size = ghc::filesystem::file_size(path);
+
+    auto check = parseRelease(path);
+    if (!check || check.value().m_assets.size() != assets) {
+        std::cerr << "parseRelease returned wrong result\n";
+        return 1;
+    }
+
+    auto sax = measure(iterations, [&]() {
+        auto res = parseRelease(path);
+    });
+    auto dom = measure(iterations, [&]() {
+        std::ifstream ifs(path, std::ios::binary);
+        std::stringstream ss;
+        ss << ifs.rdbuf();
+        auto json = nlohmann::json::parse(ss.str());
+        std::vector<std::pair<std::string, std::string>> found;
+        for (auto& asset : json["assets"]) {
+            found.push_back({
+                asset["name"].get<std::string>(),
+                asset["browser_download_url"].get<std::string>()
+            });
+        }
+    });
+
+    std::cout << "release: " << assets << " assets, " << size / 1024 << " KiB\n";
+    std::cout << "parseRelease: " << sax << " ms\n";
+    std::cout << "full DOM:     " << dom << " ms\n";
+
+    ghc::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include "Archive.hpp"
+#include "Zip.hpp"
+#include "TarZst.hpp"
+#include "MappedFile.hpp"
+#include "CancelToken.hpp"
+#include <algorithm>
+
+// fed to the decoder in pieces so the writer
+// thread gets to work on the first files early
+#define TAR_ZST_CHUNK_SIZE (1024 * 1024)
+
+static bool endsWith(std::string const& str, std::string const& suffix) {
+    return
+        str.size() >= suffix.size() &&
+        str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+tl::optional<ArchiveFormat> getArchiveFormat(std::string const& name) {
+    auto lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    if (endsWith(lower, ".zip")) {
+        return ArchiveFormat::Zip;
+    }
+    if (endsWith(lower, ".tar.zst") || endsWith(lower, ".tzst")) {
+        return ArchiveFormat::TarZst;
+    }
+    return tl::nullopt;
+}
+
+std::vector<std::string> getSupportedArchiveExtensions() {
+    #ifdef GEODE_HAS_ZSTD
+    return { ".tar.zst", ".zip" };
+    #else
+    return { ".zip" };
+    #endif
+}
+
+Result<> extractArchive(
+    ghc::filesystem::path const& archive,
+    ghc::filesystem::path const& target,
+    ZipCrcCache* crcCache,
+    bool sync,
+    JobScheduler* scheduler,
+    std::shared_ptr<CancelToken> const& cancelToken
+) {
+    auto format = getArchiveFormat(archive.filename().string());
+    if (!format) {
+        return Err("Unknown archive format: \"" + archive.filename().string() + "\"");
+    }
+    switch (format.value()) {
+        case ArchiveFormat::Zip: {
+            auto zip = ZipArchive::open(archive);
+            if (!zip) {
+                return Err(zip.error());
+            }
+            return zip.value().extractTo(target, 0, crcCache, sync, scheduler, cancelToken);
+        } break;
+
+        case ArchiveFormat::TarZst: {
+            #ifdef GEODE_HAS_ZSTD
+            auto file = MappedFile::open(archive);
+            if (!file) {
+                return Err(file.error());
+            }
+            try {
+                ghc::filesystem::create_directories(target);
+            } catch(std::exception& e) {
+                return Err(std::string(e.what()));
+            }
+            TarZstExtractor extractor(target, sync, cancelToken);
+            auto data = file.value()->getData();
+            auto size = file.value()->getSize();
+            for (size_t offset = 0; offset < size; offset += TAR_ZST_CHUNK_SIZE) {
+                auto res = extractor.write(
+                    data + offset, std::min<size_t>(size - offset, TAR_ZST_CHUNK_SIZE)
+                );
+                if (!res) return res;
+            }
+            return extractor.finish();
+            #else
+            return Err("This build can't extract .tar.zst archives");
+            #endif
+        } break;
+    }
+    return Err("Unknown archive format: \"" + archive.filename().string() + "\"");
+}
+
+class ZipArchiveStreamExtractor : public ArchiveStreamExtractor {
+protected:
+    ZipStreamExtractor m_extractor;
+    std::shared_ptr<CancelToken> m_cancelToken;
+
+public:
+    ZipArchiveStreamExtractor(
+        ghc::filesystem::path const& target,
+        std::shared_ptr<CancelToken> const& cancelToken
+    ) : m_extractor(target, true), m_cancelToken(cancelToken) {}
+
+    Result<> write(void const* data, size_t size) override {
+        if (m_cancelToken) {
+            auto res = m_cancelToken->check();
+            if (!res) return res;
+        }
+        return m_extractor.write(data, size);
+    }
+
+    Result<> finish() override {
+        auto res = m_extractor.finish();
+        if (!res) {
+            return Err(res.error());
+        }
+        return Ok();
+    }
+};
+
+#ifdef GEODE_HAS_ZSTD
+class TarZstArchiveStreamExtractor : public ArchiveStreamExtractor {
+protected:
+    TarZstExtractor m_extractor;
+
+public:
+    TarZstArchiveStreamExtractor(
+        ghc::filesystem::path const& target,
+        std::shared_ptr<CancelToken> const& cancelToken
+    ) : m_extractor(target, true, cancelToken) {}
+
+    Result<> write(void const* data, size_t size) override {
+        return m_extractor.write(data, size);
+    }
+
+    Result<> finish() override {
+        return m_extractor.finish();
+    }
+};
+#endif
+
+Result<std::shared_ptr<ArchiveStreamExtractor>> ArchiveStreamExtractor::create(
+    std::string const& name,
+    ghc::filesystem::path const& target,
+    std::shared_ptr<CancelToken> const& cancelToken
+) {
+    auto format = getArchiveFormat(name);
+    if (format == ArchiveFormat::Zip) {
+        return Ok(std::static_pointer_cast<ArchiveStreamExtractor>(
+            std::make_shared<ZipArchiveStreamExtractor>(target, cancelToken)
+        ));
+    }
+    #ifdef GEODE_HAS_ZSTD
+    if (format == ArchiveFormat::TarZst) {
+        return Ok(std::static_pointer_cast<ArchiveStreamExtractor>(
+            std::make_shared<TarZstArchiveStreamExtractor>(target, cancelToken)
+        ));
+    }
+    #endif
+    return Err("Unable to extract \"" + name + "\": unsupported archive format");
+}
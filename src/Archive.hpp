@@ -0,0 +1,70 @@
+#pragma once
+
+#include "legacy/filesystem.hpp"
+#include "legacy/optional.hpp"
+#include "include/Result.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+class ZipCrcCache;
+class JobScheduler;
+class CancelToken;
+
+enum class ArchiveFormat {
+    Zip,
+    TarZst,
+};
+
+/**
+ * Figure out the format of an archive
+ * from its file name
+ */
+tl::optional<ArchiveFormat> getArchiveFormat(std::string const& name);
+
+/**
+ * Archive extensions this build can extract,
+ * the fastest one to extract first
+ */
+std::vector<std::string> getSupportedArchiveExtensions();
+
+/**
+ * Extract an archive of any supported format
+ * into the target directory. The CRC cache is
+ * only used for zips, as tars have no checksums
+ * to compare existing files against. Zip entries
+ * are extracted on the scheduler if one is given.
+ * A cancelled extraction leaves whatever it wrote
+ * so far in target
+ */
+Result<> extractArchive(
+    ghc::filesystem::path const& archive,
+    ghc::filesystem::path const& target,
+    ZipCrcCache* crcCache = nullptr,
+    bool sync = false,
+    JobScheduler* scheduler = nullptr,
+    std::shared_ptr<CancelToken> const& cancelToken = nullptr
+);
+
+/**
+ * Extracts an archive as its bytes arrive
+ */
+class ArchiveStreamExtractor {
+public:
+    virtual ~ArchiveStreamExtractor() = default;
+
+    virtual Result<> write(void const* data, size_t size) = 0;
+    virtual Result<> finish() = 0;
+
+    /**
+     * Create an extractor for the format of the
+     * archive with the given name. Once the token
+     * is cancelled, writes fail and files that
+     * are still queued are dropped
+     */
+    static Result<std::shared_ptr<ArchiveStreamExtractor>> create(
+        std::string const& name,
+        ghc::filesystem::path const& target,
+        std::shared_ptr<CancelToken> const& cancelToken = nullptr
+    );
+};
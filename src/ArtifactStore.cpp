@@ -0,0 +1,353 @@
+#include "ArtifactStore.hpp"
+#include "Download.hpp"
+#include "Hash.hpp"
+#include "include/json.hpp"
+#include <fstream>
+#include <algorithm>
+#include <vector>
+
+#define INDEX_JSON "index.json"
+#define OBJECTS_DIR "objects"
+#define STAGING_DIR "tmp"
+#define HASH_READ_SIZE (1024 * 1024)
+#define DEFAULT_BUDGET (512ull * 1024 * 1024)
+
+static int64_t now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+static std::string toLower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return str;
+}
+
+static Result<std::string> hashFile(ghc::filesystem::path const& file) {
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs.is_open()) {
+        return Err("Unable to open \"" + file.string() + "\"");
+    }
+    Sha256 hasher;
+    std::vector<char> buffer(HASH_READ_SIZE);
+    while (ifs) {
+        ifs.read(buffer.data(), buffer.size());
+        hasher.update(buffer.data(), static_cast<size_t>(ifs.gcount()));
+    }
+    if (ifs.bad()) {
+        return Err("Unable to read \"" + file.string() + "\"");
+    }
+    return Ok(hasher.finish());
+}
+
+ArtifactStore::ArtifactStore() : m_budget(DEFAULT_BUDGET) {}
+
+void ArtifactStore::setDirectory(ghc::filesystem::path const& directory) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_directory = directory;
+    this->load();
+}
+
+uint64_t ArtifactStore::getBudget() const {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_budget;
+}
+
+void ArtifactStore::setBudget(uint64_t budget) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_budget = budget;
+}
+
+uint64_t ArtifactStore::getSize() const {
+    std::lock_guard<std::mutex> lock(m_lock);
+    uint64_t size = 0;
+    for (auto& [_, object] : m_objects) {
+        size += object.m_size;
+    }
+    return size;
+}
+
+ghc::filesystem::path ArtifactStore::getObjectPath(std::string const& hash) const {
+    // spread out so no single directory gets huge
+    return m_directory / OBJECTS_DIR / hash.substr(0, 2) / hash;
+}
+
+void ArtifactStore::load() {
+    m_objects.clear();
+    m_aliases.clear();
+    try {
+        auto path = m_directory / INDEX_JSON;
+        if (!ghc::filesystem::exists(path)) {
+            return;
+        }
+        std::ifstream ifs(path);
+        auto json = nlohmann::json::parse(ifs);
+        for (auto& [hash, object] : json.at("objects").items()) {
+            // deleted behind our back
+            std::error_code ec;
+            if (!ghc::filesystem::exists(this->getObjectPath(hash), ec)) {
+                continue;
+            }
+            m_objects.insert({ hash, {
+                object.at("size").get<uint64_t>(),
+                object.at("last-used").get<int64_t>(),
+            } });
+        }
+        for (auto& [url, alias] : json.at("aliases").items()) {
+            auto hash = alias.at("hash").get<std::string>();
+            if (!m_objects.count(hash)) {
+                continue;
+            }
+            m_aliases.insert({ url, { hash, alias.at("fetched").get<int64_t>() } });
+        }
+    } catch(std::exception&) {
+        // the objects are still there and just
+        // get downloaded again if needed
+        m_objects.clear();
+        m_aliases.clear();
+    }
+}
+
+Result<> ArtifactStore::save() const {
+    nlohmann::json json;
+    json["objects"] = nlohmann::json::object();
+    for (auto& [hash, object] : m_objects) {
+        json["objects"][hash] = {
+            { "size", object.m_size },
+            { "last-used", object.m_lastUsed },
+        };
+    }
+    json["aliases"] = nlohmann::json::object();
+    for (auto& [url, alias] : m_aliases) {
+        json["aliases"][url] = {
+            { "hash", alias.m_hash },
+            { "fetched", alias.m_fetched },
+        };
+    }
+    try {
+        ghc::filesystem::create_directories(m_directory);
+    } catch(std::exception& e) {
+        return Err(std::string(e.what()));
+    }
+    auto part = m_directory / INDEX_JSON ".part";
+    {
+        std::ofstream ofs(part);
+        if (!ofs.is_open()) {
+            return Err("Unable to write \"" + part.string() + "\"");
+        }
+        ofs << json.dump(4);
+    }
+    return placeFile(part, m_directory / INDEX_JSON);
+}
+
+bool ArtifactStore::has(std::string const& hash) const {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_objects.count(toLower(hash));
+}
+
+tl::optional<std::string> ArtifactStore::resolve(
+    std::string const& url,
+    std::chrono::seconds maxAge
+) const {
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto alias = m_aliases.find(url);
+    if (
+        alias == m_aliases.end() ||
+        !m_objects.count(alias->second.m_hash) ||
+        now() - alias->second.m_fetched >= maxAge.count()
+    ) {
+        return tl::nullopt;
+    }
+    return alias->second.m_hash;
+}
+
+ghc::filesystem::path ArtifactStore::getStagingPath(std::string const& url) const {
+    Sha256 hasher;
+    hasher.update(url.data(), url.size());
+    // keep the name of the file, extractors go by it
+    auto name = url.substr(url.find_last_of('/') + 1);
+    name = name.substr(0, name.find_first_of("?#"));
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_directory / STAGING_DIR / hasher.finish().substr(0, 16) / name;
+}
+
+Result<std::string> ArtifactStore::add(
+    ghc::filesystem::path const& file,
+    std::string const& knownHash,
+    std::string const& url
+) {
+    auto hash = toLower(knownHash);
+    if (hash.empty()) {
+        auto res = hashFile(file);
+        if (!res) {
+            return Err(res.error());
+        }
+        hash = res.value();
+    }
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto path = this->getObjectPath(hash);
+    try {
+        auto size = ghc::filesystem::file_size(file);
+        if (m_objects.count(hash) && ghc::filesystem::exists(path)) {
+            ghc::filesystem::remove(file);
+        } else {
+            ghc::filesystem::create_directories(path.parent_path());
+            auto placed = placeFile(file, path);
+            if (!placed) {
+                return Err(placed.error());
+            }
+        }
+        m_objects[hash] = { size, now() };
+    } catch(std::exception& e) {
+        return Err(std::string(e.what()));
+    }
+    if (url.size()) {
+        m_aliases[url] = { hash, now() };
+    }
+    this->save();
+    return Ok(hash);
+}
+
+Result<std::string> ArtifactStore::adopt(ghc::filesystem::path const& file) {
+    auto hashed = hashFile(file);
+    if (!hashed) {
+        return Err(hashed.error());
+    }
+    auto hash = hashed.value();
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto path = this->getObjectPath(hash);
+    std::error_code ec;
+    if (!m_objects.count(hash) || !ghc::filesystem::exists(path, ec)) {
+        auto temp = path;
+        temp += ".adopting";
+        ghc::filesystem::create_directories(path.parent_path(), ec);
+        ghc::filesystem::remove(temp, ec);
+        // never a hardlink, as whatever the file belongs 
+        // to may write to it in place and with it change 
+        // the stored copy
+        auto cloned = cloneFile(file, temp, false);
+        if (!cloned) {
+            return Err(cloned.error());
+        }
+        ghc::filesystem::rename(temp, path, ec);
+        if (ec) {
+            ghc::filesystem::remove(temp, ec);
+            return Err("Unable to add \"" + file.string() + "\" to the store");
+        }
+    }
+    m_objects[hash] = { ghc::filesystem::file_size(path, ec), now() };
+    this->save();
+    return Ok(hash);
+}
+
+bool ArtifactStore::canReflinkTo(ghc::filesystem::path const& directory) {
+    std::error_code ec;
+    ghc::filesystem::create_directories(m_directory, ec);
+    return canReflink(m_directory, directory);
+}
+
+Result<LinkMode> ArtifactStore::materialize(
+    std::string const& rawHash,
+    ghc::filesystem::path const& target,
+    bool allowHardlink
+) {
+    auto hash = toLower(rawHash);
+    ghc::filesystem::path path;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto object = m_objects.find(hash);
+        if (object == m_objects.end()) {
+            return Err("Artifact " + hash + " isn't in the store");
+        }
+        path = this->getObjectPath(hash);
+        object->second.m_lastUsed = now();
+        this->save();
+    }
+    // objects are verified when they're added, and only 
+    // a hardlink to one can change it afterwards. One 
+    // that was written to through it must not be handed 
+    // out again
+    std::error_code ec;
+    if (ghc::filesystem::hard_link_count(path, ec) > 1) {
+        auto hashed = hashFile(path);
+        if (!hashed || hashed.value() != hash) {
+            this->drop(hash);
+            return Err("Artifact " + hash + " is corrupted");
+        }
+    }
+    // already a hardlink to it. Renaming another link 
+    // over it would do nothing at all
+    if (allowHardlink && ghc::filesystem::equivalent(path, target, ec)) {
+        return Ok(LinkMode::Hardlink);
+    }
+    // cloned next to the target first so the
+    // target is replaced in one go
+    auto temp = target;
+    temp += ".materializing";
+    ghc::filesystem::create_directories(target.parent_path(), ec);
+    ghc::filesystem::remove(temp, ec);
+    auto cloned = cloneFile(path, temp, allowHardlink);
+    if (!cloned) {
+        return Err("Unable to copy artifact: " + cloned.error());
+    }
+    auto placed = placeFile(temp, target);
+    if (!placed) {
+        ghc::filesystem::remove(temp, ec);
+        return Err(placed.error());
+    }
+    return cloned;
+}
+
+void ArtifactStore::drop(std::string const& hash) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    std::error_code ec;
+    ghc::filesystem::remove(this->getObjectPath(hash), ec);
+    m_objects.erase(hash);
+    for (auto it = m_aliases.begin(); it != m_aliases.end();) {
+        if (it->second.m_hash == hash) {
+            it = m_aliases.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    this->save();
+}
+
+void ArtifactStore::collectGarbage(std::string const& rawKeep) {
+    auto keep = toLower(rawKeep);
+    std::lock_guard<std::mutex> lock(m_lock);
+    uint64_t size = 0;
+    std::vector<std::pair<std::string, Object>> objects;
+    for (auto& object : m_objects) {
+        size += object.second.m_size;
+        objects.push_back(object);
+    }
+    if (size <= m_budget) {
+        return;
+    }
+    std::sort(objects.begin(), objects.end(), [](auto const& a, auto const& b) {
+        return a.second.m_lastUsed < b.second.m_lastUsed;
+    });
+    for (auto& [hash, object] : objects) {
+        if (size <= m_budget) break;
+        if (hash == keep) continue;
+        std::error_code ec;
+        auto path = this->getObjectPath(hash);
+        ghc::filesystem::remove(path, ec);
+        if (ec) continue;
+        // only goes through if it's empty
+        ghc::filesystem::remove(path.parent_path(), ec);
+        m_objects.erase(hash);
+        size -= object.m_size;
+    }
+    for (auto it = m_aliases.begin(); it != m_aliases.end();) {
+        if (m_objects.count(it->second.m_hash)) {
+            ++it;
+        } else {
+            it = m_aliases.erase(it);
+        }
+    }
+    this->save();
+}
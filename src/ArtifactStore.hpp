@@ -0,0 +1,123 @@
+#pragma once
+
+#include "legacy/filesystem.hpp"
+#include "legacy/optional.hpp"
+#include "include/Result.hpp"
+#include "FileLink.hpp"
+#include <string>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * Downloaded artifacts (CLI archives, the utils
+ * library) stored by their SHA-256, so the same
+ * file is only ever downloaded once no matter
+ * how many installs and updates need it. Files
+ * are cloned out of the store into their targets
+ * (see cloneFile).
+ *
+ * URLs are remembered along with the hash of
+ * what they served, so artifacts without a
+ * published checksum can be found too. Once the
+ * store grows past its budget, the artifacts
+ * used least recently are deleted. Thread-safe
+ */
+class ArtifactStore {
+protected:
+    struct Object {
+        uint64_t m_size;
+        int64_t m_lastUsed;
+    };
+    struct Alias {
+        std::string m_hash;
+        int64_t m_fetched;
+    };
+
+    ghc::filesystem::path m_directory;
+    uint64_t m_budget;
+    std::unordered_map<std::string, Object> m_objects;
+    std::unordered_map<std::string, Alias> m_aliases;
+    mutable std::mutex m_lock;
+
+    ghc::filesystem::path getObjectPath(std::string const& hash) const;
+    void load();
+    Result<> save() const;
+    /**
+     * Forget about an artifact and delete it, 
+     * along with the URLs that resolve to it
+     */
+    void drop(std::string const& hash);
+
+public:
+    ArtifactStore();
+
+    void setDirectory(ghc::filesystem::path const& directory);
+    uint64_t getBudget() const;
+    void setBudget(uint64_t budget);
+    /**
+     * Total size of the artifacts in the store
+     */
+    uint64_t getSize() const;
+
+    bool has(std::string const& hash) const;
+    /**
+     * Find the hash of what the URL served when it
+     * was last downloaded, if that was less than
+     * maxAge ago and the artifact is still stored
+     */
+    tl::optional<std::string> resolve(
+        std::string const& url,
+        std::chrono::seconds maxAge
+    ) const;
+    /**
+     * Where to download an artifact from the URL
+     * to before handing it to add()
+     */
+    ghc::filesystem::path getStagingPath(std::string const& url) const;
+    /**
+     * Move a file into the store. If the hash
+     * isn't known (already verified) beforehand,
+     * the file is hashed first. Returns the hash
+     */
+    Result<std::string> add(
+        ghc::filesystem::path const& file,
+        std::string const& hash = "",
+        std::string const& url = ""
+    );
+    /**
+     * Add a file to the store while leaving it
+     * where it is, sharing its data with the
+     * stored copy if the filesystem supports
+     * reflinks. Returns the hash
+     */
+    Result<std::string> adopt(ghc::filesystem::path const& file);
+    /**
+     * Put a copy of an artifact at target,
+     * replacing whatever is there. If the
+     * artifact has hardlinks, it's verified
+     * against its hash first and dropped from
+     * the store if it doesn't match. If
+     * allowHardlink is set, the target may be a
+     * hardlink to the stored artifact, and must
+     * then never be written to in place
+     */
+    Result<LinkMode> materialize(
+        std::string const& hash,
+        ghc::filesystem::path const& target,
+        bool allowHardlink = false
+    );
+    /**
+     * Whether artifacts can be materialized into
+     * the directory as reflinks, i.e. without
+     * taking up any extra space
+     */
+    bool canReflinkTo(ghc::filesystem::path const& directory);
+    /**
+     * Delete the least recently used artifacts
+     * until the store fits its budget again. The
+     * artifact with the given hash is kept even
+     * if it doesn't fit
+     */
+    void collectGarbage(std::string const& keep = "");
+};
@@ -0,0 +1,54 @@
+#include "CancelToken.hpp"
+#include <vector>
+
+std::shared_ptr<CancelToken> CancelToken::create() {
+    return std::make_shared<CancelToken>();
+}
+
+bool CancelToken::isCancelled() const {
+    return m_cancelled;
+}
+
+Result<> CancelToken::check() const {
+    if (m_cancelled) {
+        return Err("Cancelled");
+    }
+    return Ok();
+}
+
+void CancelToken::cancel() {
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_cancelled.exchange(true)) {
+            return;
+        }
+        for (auto& [_, func] : m_callbacks) {
+            callbacks.push_back(std::move(func));
+        }
+        m_callbacks.clear();
+    }
+    // outside the lock, as callbacks may well
+    // remove themselves or others
+    for (auto& func : callbacks) {
+        func();
+    }
+}
+
+size_t CancelToken::onCancel(std::function<void()> func) {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_cancelled) {
+            auto id = m_nextCallback++;
+            m_callbacks.insert({ id, std::move(func) });
+            return id;
+        }
+    }
+    func();
+    return 0;
+}
+
+void CancelToken::removeCallback(size_t id) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_callbacks.erase(id);
+}
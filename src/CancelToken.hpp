@@ -0,0 +1,55 @@
+#pragma once
+
+#include "include/Result.hpp"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+/**
+ * Shared between an operation and whoever may
+ * want to stop it. Code running on a thread of
+ * its own checks isCancelled() between pieces
+ * of work; code waiting on something (a web
+ * request) registers a callback that stops it
+ * right away.
+ * 
+ * A cancelled operation cleans up after itself
+ * but doesn't report back to its caller, who
+ * may not be around anymore. Thread-safe
+ */
+class CancelToken {
+protected:
+    std::atomic<bool> m_cancelled = false;
+    std::mutex m_lock;
+    std::unordered_map<size_t, std::function<void()>> m_callbacks;
+    size_t m_nextCallback = 1;
+
+public:
+    static std::shared_ptr<CancelToken> create();
+
+    bool isCancelled() const;
+    /**
+     * Err if the token has been cancelled, for
+     * bailing out of functions that return
+     * Results
+     */
+    Result<> check() const;
+    /**
+     * Cancel the token and run every registered
+     * callback on the calling thread
+     */
+    void cancel();
+    /**
+     * Call func once the token is cancelled, or
+     * right away if it already is. Returns an ID
+     * for removeCallback
+     */
+    size_t onCancel(std::function<void()> func);
+    /**
+     * Call once the operation is done, so the
+     * callback doesn't outlive what it stops
+     */
+    void removeCallback(size_t id);
+};
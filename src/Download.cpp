@@ -0,0 +1,680 @@
+#include "Download.hpp"
+#include <algorithm>
+#include <fstream>
+
+// splitting a file into pieces smaller than
+// this costs more in round trips than it saves
+#define MIN_SEGMENT_SIZE (1024 * 1024)
+#define MAX_SEGMENT_RETRIES 3
+#define STATE_SAVE_INTERVAL std::chrono::seconds(1)
+#define HASH_READ_SIZE (1024 * 1024)
+#define ASIDE_EXTENSION ".old"
+
+Result<> placeFile(
+    ghc::filesystem::path const& from,
+    ghc::filesystem::path const& to
+) {
+    std::error_code ec;
+    ghc::filesystem::rename(from, to, ec);
+    if (!ec) {
+        return Ok();
+    }
+
+    // a library that's loaded can't be replaced 
+    // on Windows, but it can be renamed. It can't 
+    // be deleted until it's unloaded though, which 
+    // may be never for the utils library, so each 
+    // one gets a name of its own
+    if (ghc::filesystem::exists(to)) {
+        auto old = to;
+        old += "." + std::to_string(
+            std::chrono::steady_clock::now().time_since_epoch().count()
+        ) + ASIDE_EXTENSION;
+        std::error_code oldEc;
+        ghc::filesystem::rename(to, old, oldEc);
+        if (!oldEc) {
+            ghc::filesystem::rename(from, to, ec);
+            if (!ec) {
+                ghc::filesystem::remove(old, oldEc);
+                return Ok();
+            }
+            ghc::filesystem::rename(old, to, oldEc);
+        }
+    }
+
+    // different filesystems; copy next to the 
+    // target so it can still be replaced atomically
+    auto part = to;
+    part += ".placing";
+    try {
+        ghc::filesystem::copy_file(
+            from, part, ghc::filesystem::copy_options::overwrite_existing
+        );
+        ghc::filesystem::rename(part, to);
+        ghc::filesystem::remove(from);
+    } catch(std::exception& e) {
+        ghc::filesystem::remove(part, ec);
+        return Err(e.what());
+    }
+    return Ok();
+}
+
+static bool isAsideFile(ghc::filesystem::path const& path) {
+    // <name>.<number>.old
+    auto name = path.filename().string();
+    auto ext = std::string(ASIDE_EXTENSION);
+    if (name.size() <= ext.size() || name.compare(name.size() - ext.size(), ext.size(), ext)) {
+        return false;
+    }
+    name.resize(name.size() - ext.size());
+    auto dot = name.find_last_of('.');
+    return
+        dot != std::string::npos && dot + 1 < name.size() &&
+        std::all_of(name.begin() + dot + 1, name.end(), [](char c) {
+            return c >= '0' && c <= '9';
+        });
+}
+
+void removeAsideFiles(ghc::filesystem::path const& directory, bool recursive) {
+    std::error_code ec;
+    std::vector<ghc::filesystem::path> files;
+    if (recursive) {
+        for (
+            auto it = ghc::filesystem::recursive_directory_iterator(directory, ec);
+            it != ghc::filesystem::recursive_directory_iterator();
+            it.increment(ec)
+        ) {
+            if (ec) break;
+            if (isAsideFile(it->path())) files.push_back(it->path());
+        }
+    } else {
+        for (
+            auto it = ghc::filesystem::directory_iterator(directory, ec);
+            it != ghc::filesystem::directory_iterator();
+            it.increment(ec)
+        ) {
+            if (ec) break;
+            if (isAsideFile(it->path())) files.push_back(it->path());
+        }
+    }
+    for (auto& file : files) {
+        // still loaded if this fails
+        ghc::filesystem::remove(file, ec);
+    }
+}
+
+std::shared_ptr<Download> Download::create(
+    std::string const& url,
+    ghc::filesystem::path const& target,
+    size_t maxSegments,
+    DownloadErrorFunc errorFunc,
+    DownloadProgressFunc progressFunc,
+    DownloadFileFinishFunc finishFunc,
+    std::string const& sha256,
+    std::shared_ptr<CancelToken> const& cancelToken
+) {
+    auto download = std::shared_ptr<Download>(new Download());
+    download->m_url = url;
+    download->m_target = target;
+    download->m_partPath = target;
+    download->m_partPath += ".part";
+    download->m_statePath = target;
+    download->m_statePath += ".part.json";
+    download->m_maxSegments = std::max<size_t>(maxSegments, 1);
+    download->m_errorFunc = errorFunc;
+    download->m_progressFunc = progressFunc;
+    download->m_finishFunc = finishFunc;
+    download->m_sha256 = sha256;
+    download->m_cancelToken = cancelToken;
+    return download;
+}
+
+void Download::start() {
+    this->listenForCancel();
+    if (m_failed) return;
+    this->cancelRequests();
+    m_generation++;
+
+    if (m_progressFunc) m_progressFunc("Connecting", 0);
+
+    auto self = shared_from_this();
+    auto generation = m_generation;
+    auto request = Manager::get()->createWebRequest(
+        m_url,
+        [self, generation](wxWebRequestEvent& evt) -> void {
+            if (self->m_failed || generation != self->m_generation) return;
+            self->onProbe(evt);
+        }
+    );
+    if (!request.IsOk()) {
+        return this->fail("Unable to create web request");
+    }
+    request.SetMethod("HEAD");
+    m_requests.push_back(request);
+    request.Start();
+}
+
+void Download::onProbe(wxWebRequestEvent& evt) {
+    switch (evt.GetState()) {
+        case wxWebRequest::State_Completed: {
+            auto res = evt.GetResponse();
+            auto ranged = false;
+            if (res.IsOk() && res.GetStatus() == 200) {
+                m_size = res.GetContentLength();
+                m_resolvedURL = res.GetURL().ToStdString();
+                m_etag = res.GetHeader("ETag").ToStdString();
+                m_lastModified = res.GetHeader("Last-Modified").ToStdString();
+                ranged = res.GetHeader("Accept-Ranges").Lower() == "bytes";
+            }
+            if (ranged && this->resumeSegments()) {
+                return;
+            }
+            this->startSegments(ranged);
+        } break;
+
+        // not every server likes HEAD requests,
+        // so just try downloading it normally
+        case wxWebRequest::State_Unauthorized:
+        case wxWebRequest::State_Failed: {
+            this->startSegments(false);
+        } break;
+
+        case wxWebRequest::State_Cancelled: {
+            this->fail("Web request cancelled");
+        } break;
+
+        default: break;
+    }
+}
+
+void Download::onRangeIgnored() {
+    // either the file changed since the partial
+    // download (so If-Range didn't match), or the
+    // server doesn't actually honor ranges. try
+    // again from scratch once and then give up
+    // on ranges altogether
+    if (!m_restarted) {
+        m_restarted = true;
+        this->discardState();
+        return this->start();
+    }
+    this->startSegments(false);
+}
+
+bool Download::resumeSegments() {
+    if (!this->isResumable()) {
+        return false;
+    }
+    std::vector<DownloadSegment> segments;
+    try {
+        if (
+            !ghc::filesystem::exists(m_statePath) ||
+            !ghc::filesystem::exists(m_partPath) ||
+            ghc::filesystem::file_size(m_partPath) != static_cast<uintmax_t>(m_size)
+        ) {
+            return false;
+        }
+        std::ifstream ifs(m_statePath);
+        auto json = nlohmann::json::parse(ifs);
+        if (
+            json["url"].get<std::string>() != m_url ||
+            json["size"].get<wxFileOffset>() != m_size ||
+            json["etag"].get<std::string>() != m_etag ||
+            json["last-modified"].get<std::string>() != m_lastModified
+        ) {
+            return false;
+        }
+        for (auto& seg : json["segments"]) {
+            DownloadSegment segment;
+            segment.m_start = seg["start"].get<wxFileOffset>();
+            segment.m_end = seg["end"].get<wxFileOffset>();
+            segment.m_received = seg["received"].get<wxFileOffset>();
+            segment.m_ranged = true;
+            if (
+                segment.m_start < 0 || segment.m_end > m_size ||
+                segment.m_received < 0 ||
+                segment.m_start + segment.m_received > segment.m_end
+            ) {
+                return false;
+            }
+            segment.m_done = segment.m_start + segment.m_received == segment.m_end;
+            segments.push_back(segment);
+        }
+        if (segments.empty()) {
+            return false;
+        }
+    } catch(std::exception&) {
+        return false;
+    }
+
+    if (m_file.IsOpened()) {
+        m_file.Close();
+    }
+    if (!m_file.Open(m_partPath.wstring(), wxFile::read_write)) {
+        return false;
+    }
+
+    m_generation++;
+    m_segments = segments;
+    m_lastStateSave = std::chrono::steady_clock::now();
+    // what was downloaded before has to be hashed
+    // again, as the hasher state isn't persisted
+    this->resetHash();
+    this->catchUpHash();
+    this->reportProgress();
+
+    for (size_t i = 0; i < m_segments.size(); i++) {
+        if (m_segments.at(i).m_done) continue;
+        this->startSegment(i);
+        if (m_failed) return true;
+    }
+    if (std::all_of(m_segments.begin(), m_segments.end(), [](auto const& seg) {
+        return seg.m_done;
+    })) {
+        this->finish();
+    }
+    return true;
+}
+
+void Download::startSegments(bool ranged) {
+    this->cancelRequests();
+    m_generation++;
+    m_segments.clear();
+    this->resetHash();
+
+    size_t count = 1;
+    if (ranged && m_size > 0) {
+        count = std::clamp<size_t>(
+            static_cast<size_t>(m_size / MIN_SEGMENT_SIZE), 1, m_maxSegments
+        );
+    } else {
+        ranged = false;
+    }
+    auto segmentSize = ranged ? m_size / count : 0;
+    for (size_t i = 0; i < count; i++) {
+        DownloadSegment segment;
+        segment.m_ranged = ranged;
+        if (ranged) {
+            segment.m_start = segmentSize * i;
+            segment.m_end = i == count - 1 ? m_size : segmentSize * (i + 1);
+        }
+        m_segments.push_back(segment);
+    }
+
+    try {
+        if (!ghc::filesystem::exists(m_target.parent_path())) {
+            ghc::filesystem::create_directories(m_target.parent_path());
+        }
+        if (m_file.IsOpened()) {
+            m_file.Close();
+        }
+        if (!m_file.Create(m_partPath.wstring(), true)) {
+            return this->fail("Unable to create file \"" + m_partPath.string() + "\"");
+        }
+        // reserve the whole file up front so the
+        // segments can be written in any order
+        if (ranged) {
+            ghc::filesystem::resize_file(m_partPath, m_size);
+        }
+    } catch(std::exception& e) {
+        return this->fail(e.what());
+    }
+    this->saveState();
+
+    for (size_t i = 0; i < m_segments.size(); i++) {
+        this->startSegment(i);
+        if (m_failed) return;
+    }
+}
+
+void Download::startSegment(size_t index) {
+    auto self = shared_from_this();
+    auto generation = m_generation;
+    auto request = Manager::get()->createWebRequest(
+        m_resolvedURL.size() ? m_resolvedURL : m_url,
+        [self, generation, index](wxWebRequestEvent& evt) -> void {
+            if (self->m_failed || generation != self->m_generation) return;
+            self->onSegmentState(index, evt);
+        },
+        [self, generation, index](wxWebRequestEvent& evt) -> void {
+            if (self->m_failed || generation != self->m_generation) return;
+            self->onSegmentData(index, evt);
+        }
+    );
+    if (!request.IsOk()) {
+        return this->fail("Unable to create web request");
+    }
+    auto& segment = m_segments.at(index);
+    if (segment.m_ranged) {
+        request.SetHeader(
+            "Range",
+            "bytes=" + std::to_string(segment.m_start + segment.m_received) + "-" +
+                std::to_string(segment.m_end - 1)
+        );
+        auto validator = this->getValidator();
+        if (validator.size()) {
+            request.SetHeader("If-Range", validator);
+        }
+    }
+    request.SetStorage(wxWebRequest::Storage_None);
+    m_requests.push_back(request);
+    request.Start();
+}
+
+void Download::onSegmentData(size_t index, wxWebRequestEvent& evt) {
+    auto& segment = m_segments.at(index);
+    if (segment.m_ranged && evt.GetResponse().GetStatus() != 206) {
+        return this->onRangeIgnored();
+    }
+    auto size = static_cast<wxFileOffset>(evt.GetDataSize());
+    auto offset = segment.m_start + segment.m_received;
+    if (segment.m_end != -1 && offset + size > segment.m_end) {
+        return this->fail("Server sent more data than expected");
+    }
+    if (
+        m_file.Seek(offset) != offset ||
+        m_file.Write(evt.GetDataBuffer(), evt.GetDataSize()) != evt.GetDataSize()
+    ) {
+        return this->fail("Unable to write to \"" + m_partPath.string() + "\"");
+    }
+    segment.m_received += size;
+    this->hashData(offset, evt.GetDataBuffer(), evt.GetDataSize());
+
+    // the recorded progress may lag behind what's
+    // actually on disk, which only means a bit of
+    // data gets downloaded twice after a crash
+    if (std::chrono::steady_clock::now() - m_lastStateSave > STATE_SAVE_INTERVAL) {
+        this->saveState();
+    }
+    this->reportProgress();
+}
+
+void Download::onSegmentState(size_t index, wxWebRequestEvent& evt) {
+    auto& segment = m_segments.at(index);
+
+    auto retry = [this, index](std::string const& error) -> void {
+        auto& segment = m_segments.at(index);
+        if (
+            this->isResumable() &&
+            segment.m_ranged &&
+            segment.m_retries < MAX_SEGMENT_RETRIES
+        ) {
+            segment.m_retries++;
+            this->saveState();
+            return this->startSegment(index);
+        }
+        this->fail(error);
+    };
+
+    switch (evt.GetState()) {
+        case wxWebRequest::State_Completed: {
+            auto res = evt.GetResponse();
+            if (!res.IsOk()) {
+                return this->fail("Web request returned not OK");
+            }
+            if (segment.m_ranged && res.GetStatus() == 200) {
+                return this->onRangeIgnored();
+            }
+            if (res.GetStatus() != (segment.m_ranged ? 206 : 200)) {
+                return this->fail("Web request returned " + std::to_string(res.GetStatus()));
+            }
+            if (
+                segment.m_end != -1 &&
+                segment.m_start + segment.m_received != segment.m_end
+            ) {
+                return retry("Download ended early");
+            }
+            segment.m_done = true;
+            if (std::all_of(m_segments.begin(), m_segments.end(), [](auto const& seg) {
+                return seg.m_done;
+            })) {
+                this->finish();
+            }
+        } break;
+
+        case wxWebRequest::State_Unauthorized: {
+            this->fail("Unauthorized to do web request");
+        } break;
+
+        case wxWebRequest::State_Failed: {
+            retry("Web request failed");
+        } break;
+
+        case wxWebRequest::State_Cancelled: {
+            this->fail("Web request cancelled");
+        } break;
+
+        default: break;
+    }
+}
+
+void Download::cancelRequests() {
+    for (auto& request : m_requests) {
+        if (
+            request.GetState() == wxWebRequest::State_Idle ||
+            request.GetState() == wxWebRequest::State_Active
+        ) {
+            request.Cancel();
+        }
+    }
+    m_requests.clear();
+}
+
+void Download::reportProgress() {
+    if (!m_progressFunc) return;
+    if (m_size <= 0) {
+        return m_progressFunc("Downloading", 0);
+    }
+    wxFileOffset received = 0;
+    for (auto& segment : m_segments) {
+        received += segment.m_received;
+    }
+    m_progressFunc(
+        "Downloading",
+        static_cast<int>(static_cast<double>(received) / m_size * 100.0)
+    );
+}
+
+void Download::resetHash() {
+    m_hasher.reset();
+    m_hashed = 0;
+    m_hashing = false;
+    m_finishing = false;
+    m_hashEpoch++;
+}
+
+void Download::hashData(wxFileOffset offset, void const* data, size_t size) {
+    if (m_sha256.empty()) return;
+    // the common case: data arriving right at the
+    // end of the hashed prefix is hashed straight
+    // from the network buffer
+    if (!m_hashing && offset == m_hashed) {
+        m_hasher.update(data, size);
+        m_hashed += size;
+    }
+    this->catchUpHash();
+}
+
+wxFileOffset Download::getHashableEnd() const {
+    // segments are contiguous and in order
+    auto end = m_hashed;
+    for (auto& segment : m_segments) {
+        if (segment.m_end != -1 && end >= segment.m_end) continue;
+        end = std::max(end, segment.m_start + segment.m_received);
+        if (segment.m_end == -1 || end < segment.m_end) break;
+    }
+    return end;
+}
+
+void Download::catchUpHash() {
+    if (m_sha256.empty() || m_hashing) return;
+    auto end = this->getHashableEnd();
+    if (end <= m_hashed) return;
+
+    // the hasher is handed to the job by value, so the
+    // main thread never touches it while it runs
+    m_hashing = true;
+    auto self = shared_from_this();
+    auto epoch = m_hashEpoch;
+    auto hasher = m_hasher;
+    auto start = m_hashed;
+    auto path = m_partPath;
+    auto submitted = Manager::get()->getJobScheduler().submit(
+        [self, epoch, hasher, start, end, path]() mutable -> void {
+            std::ifstream file(path, std::ios::binary);
+            file.seekg(start);
+            std::vector<char> buffer;
+            auto hashed = start;
+            while (file && hashed < end) {
+                buffer.resize(static_cast<size_t>(
+                    std::min<wxFileOffset>(end - hashed, HASH_READ_SIZE)
+                ));
+                if (!file.read(buffer.data(), buffer.size())) break;
+                hasher.update(buffer.data(), buffer.size());
+                hashed += buffer.size();
+            }
+            auto ok = hashed == end;
+            wxQueueEvent(Manager::get(), new CallOnMainEvent(
+                [self, epoch, ok, hasher, hashed]() -> void {
+                    self->onHashCaughtUp(epoch, ok, hasher, hashed);
+                },
+                CALL_ON_MAIN,
+                wxID_ANY
+            ));
+        },
+        JobPriority::Bulk
+    );
+    if (!submitted) {
+        m_hashing = false;
+        this->fail("Unable to hash \"" + m_partPath.string() + "\"");
+    }
+}
+
+void Download::onHashCaughtUp(
+    size_t epoch, bool ok, Sha256 const& hasher, wxFileOffset hashed
+) {
+    if (m_failed || epoch != m_hashEpoch) return;
+    m_hashing = false;
+    if (!ok) {
+        return this->fail("Unable to read \"" + m_partPath.string() + "\"");
+    }
+    m_hasher = hasher;
+    m_hashed = hashed;
+    if (m_finishing) {
+        return this->finish();
+    }
+    // more may have come in while the job ran
+    this->catchUpHash();
+}
+
+std::string Download::getValidator() const {
+    // If-Range only works with strong validators
+    if (m_etag.size() && m_etag.rfind("W/", 0) != 0) {
+        return m_etag;
+    }
+    return m_lastModified;
+}
+
+bool Download::isResumable() const {
+    return
+        m_size > 0 &&
+        m_segments.size() &&
+        m_segments.front().m_ranged &&
+        this->getValidator().size();
+}
+
+void Download::saveState() {
+    m_lastStateSave = std::chrono::steady_clock::now();
+    if (!this->isResumable()) return;
+
+    nlohmann::json json;
+    json["url"] = m_url;
+    json["size"] = m_size;
+    json["etag"] = m_etag;
+    json["last-modified"] = m_lastModified;
+    json["segments"] = nlohmann::json::array();
+    for (auto& segment : m_segments) {
+        nlohmann::json seg;
+        seg["start"] = segment.m_start;
+        seg["end"] = segment.m_end;
+        seg["received"] = segment.m_received;
+        json["segments"].push_back(seg);
+    }
+    std::ofstream ofs(m_statePath);
+    ofs << json.dump(4);
+}
+
+void Download::discardState() {
+    if (m_file.IsOpened()) {
+        m_file.Close();
+    }
+    std::error_code ec;
+    ghc::filesystem::remove(m_statePath, ec);
+    ghc::filesystem::remove(m_partPath, ec);
+}
+
+void Download::listenForCancel() {
+    if (!m_cancelToken || m_cancelCallback) return;
+    std::weak_ptr<Download> weak = shared_from_this();
+    m_cancelCallback = m_cancelToken->onCancel([weak]() -> void {
+        if (auto self = weak.lock()) {
+            self->fail("Cancelled");
+        }
+    });
+}
+
+void Download::stopListeningForCancel() {
+    if (m_cancelToken && m_cancelCallback) {
+        m_cancelToken->removeCallback(m_cancelCallback);
+        m_cancelCallback = 0;
+    }
+}
+
+void Download::fail(std::string const& error) {
+    if (m_failed) return;
+    m_failed = true;
+    this->stopListeningForCancel();
+    this->cancelRequests();
+    // keep what we have so the next attempt
+    // doesn't have to download it again
+    if (this->isResumable()) {
+        this->saveState();
+        if (m_file.IsOpened()) {
+            m_file.Close();
+        }
+    } else {
+        this->discardState();
+    }
+    if (m_errorFunc) m_errorFunc(error);
+}
+
+void Download::finish() {
+    m_requests.clear();
+    if (m_sha256.size()) {
+        this->catchUpHash();
+        // called again once the hash has caught up
+        if (m_hashing) {
+            m_finishing = true;
+            return;
+        }
+        auto digest = m_hasher.finish();
+        this->resetHash();
+        if (!digestsMatch(digest, m_sha256)) {
+            // nothing of this is worth resuming
+            m_segments.clear();
+            return this->fail(
+                "Checksum mismatch for \"" + m_target.filename().string() +
+                "\": expected " + m_sha256 + ", got " + digest
+            );
+        }
+    }
+    m_file.Close();
+    auto placed = placeFile(m_partPath, m_target);
+    if (!placed) {
+        return this->fail("Unable to move download into place: " + placed.error());
+    }
+    std::error_code ec;
+    ghc::filesystem::remove(m_statePath, ec);
+    this->stopListeningForCancel();
+    if (m_finishFunc) m_finishFunc(m_target);
+}
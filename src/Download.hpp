@@ -0,0 +1,155 @@
+#pragma once
+
+#include "Manager.hpp"
+#include "Hash.hpp"
+#include "CancelToken.hpp"
+#include <vector>
+#include <chrono>
+
+/**
+ * Move a file to a new path, replacing whatever 
+ * is there atomically. Within a filesystem this 
+ * is a plain rename; if the file in the way 
+ * can't be replaced (a loaded library on 
+ * Windows) it's moved aside first, and across 
+ * filesystems the file is copied next to the 
+ * target and renamed over it
+ */
+Result<> placeFile(
+    ghc::filesystem::path const& from,
+    ghc::filesystem::path const& to
+);
+
+/**
+ * Delete the files placeFile moved aside in a 
+ * directory, which couldn't be deleted back 
+ * then. Files still in use are left alone
+ */
+void removeAsideFiles(ghc::filesystem::path const& directory, bool recursive);
+
+/**
+ * A byte range of a download that is
+ * fetched over its own connection
+ */
+struct DownloadSegment {
+    wxFileOffset m_start = 0;
+    /**
+     * Exclusive end of the segment, or -1
+     * if the size of the file is not known
+     */
+    wxFileOffset m_end = -1;
+    wxFileOffset m_received = 0;
+    size_t m_retries = 0;
+    bool m_ranged = false;
+    bool m_done = false;
+};
+
+/**
+ * Downloads a file into a target path. If the
+ * server supports Range requests, the file is
+ * split into segments that are fetched in
+ * parallel and written straight into their
+ * place in a preallocated file; otherwise the
+ * file is fetched over a single connection.
+ * The file is written to a temporary path
+ * next to the target and moved in place once
+ * every segment has finished.
+ * 
+ * If the server provides a validator (a strong
+ * ETag or Last-Modified), the progress of the
+ * segments is persisted next to the partial
+ * file, so a download that failed, was
+ * cancelled or was interrupted by a crash
+ * picks up where it left off using If-Range.
+ * 
+ * If a SHA-256 checksum is given, the bytes are
+ * hashed as they come in and the file is only
+ * moved in place if it matches. Data that a
+ * segment ahead of the hashed prefix wrote is
+ * read back once the prefix reaches it, which
+ * is served from the page cache, on the job
+ * scheduler so the UI isn't held up by it.
+ * 
+ * Cancelling the token given to the download
+ * stops its requests right away. What was
+ * downloaded is kept for resuming, like after
+ * any other failure
+ */
+class Download : public std::enable_shared_from_this<Download> {
+protected:
+    std::string m_url;
+    std::string m_resolvedURL;
+    ghc::filesystem::path m_target;
+    ghc::filesystem::path m_partPath;
+    ghc::filesystem::path m_statePath;
+    size_t m_maxSegments;
+    wxFileOffset m_size = -1;
+    std::string m_etag;
+    std::string m_lastModified;
+    std::vector<DownloadSegment> m_segments;
+    std::vector<wxWebRequest> m_requests;
+    wxFile m_file;
+    bool m_failed = false;
+    bool m_restarted = false;
+    std::chrono::steady_clock::time_point m_lastStateSave;
+    // bumped whenever the segments are restarted so
+    // events of the old requests can be ignored
+    size_t m_generation = 0;
+    std::string m_sha256;
+    Sha256 m_hasher;
+    // everything before this offset has been hashed
+    wxFileOffset m_hashed = 0;
+    // a job is reading data back to hash it, and
+    // owns the hasher until it's done
+    bool m_hashing = false;
+    // bumped whenever the hash is reset so the
+    // results of an old job can be ignored
+    size_t m_hashEpoch = 0;
+    // every segment is done, but the hash still
+    // has to catch up before the file is checked
+    bool m_finishing = false;
+    std::shared_ptr<CancelToken> m_cancelToken;
+    size_t m_cancelCallback = 0;
+    DownloadErrorFunc m_errorFunc;
+    DownloadProgressFunc m_progressFunc;
+    DownloadFileFinishFunc m_finishFunc;
+
+    Download() = default;
+
+    void onProbe(wxWebRequestEvent& evt);
+    void onRangeIgnored();
+    bool resumeSegments();
+    void startSegments(bool ranged);
+    void startSegment(size_t index);
+    void onSegmentData(size_t index, wxWebRequestEvent& evt);
+    void onSegmentState(size_t index, wxWebRequestEvent& evt);
+    void cancelRequests();
+    void reportProgress();
+    void resetHash();
+    void hashData(wxFileOffset offset, void const* data, size_t size);
+    wxFileOffset getHashableEnd() const;
+    void catchUpHash();
+    void onHashCaughtUp(size_t epoch, bool ok, Sha256 const& hasher, wxFileOffset hashed);
+    std::string getValidator() const;
+    bool isResumable() const;
+    void saveState();
+    void discardState();
+    void listenForCancel();
+    void stopListeningForCancel();
+    void fail(std::string const& error);
+    void finish();
+
+public:
+    static std::shared_ptr<Download> create(
+        std::string const& url,
+        ghc::filesystem::path const& target,
+        size_t maxSegments,
+        DownloadErrorFunc errorFunc,
+        DownloadProgressFunc progressFunc,
+        DownloadFileFinishFunc finishFunc,
+        std::string const& sha256 = "",
+        std::shared_ptr<CancelToken> const& cancelToken = nullptr
+    );
+
+    void start();
+};
@@ -0,0 +1,242 @@
+#include "FileLink.hpp"
+#include <algorithm>
+
+#if defined(__APPLE__)
+#include <sys/clonefile.h>
+#include <sys/attr.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <Windows.h>
+#include <winioctl.h>
+// a single FSCTL_DUPLICATE_EXTENTS_TO_FILE can 
+// clone at most just under 4 GiB
+#define CLONE_CHUNK_SIZE (1024ll * 1024 * 1024)
+#endif
+
+#ifdef _WIN32
+
+static bool duplicateExtents(HANDLE src, HANDLE dst) {
+    LARGE_INTEGER size;
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileSizeEx(src, &size) || !GetFileInformationByHandle(src, &info)) {
+        return false;
+    }
+    DWORD bytes;
+    // the clone has to match the source in whether 
+    // it's sparse and in its integrity settings
+    if (
+        info.dwFileAttributes & FILE_ATTRIBUTE_SPARSE_FILE &&
+        !DeviceIoControl(dst, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &bytes, nullptr)
+    ) {
+        return false;
+    }
+    FSCTL_GET_INTEGRITY_INFORMATION_BUFFER integrity {};
+    if (!DeviceIoControl(
+        src, FSCTL_GET_INTEGRITY_INFORMATION,
+        nullptr, 0, &integrity, sizeof(integrity), &bytes, nullptr
+    )) {
+        return false;
+    }
+    FSCTL_SET_INTEGRITY_INFORMATION_BUFFER setIntegrity {};
+    setIntegrity.ChecksumAlgorithm = integrity.ChecksumAlgorithm;
+    setIntegrity.Flags = integrity.Flags;
+    if (!DeviceIoControl(
+        dst, FSCTL_SET_INTEGRITY_INFORMATION,
+        &setIntegrity, sizeof(setIntegrity), nullptr, 0, &bytes, nullptr
+    )) {
+        return false;
+    }
+    FILE_END_OF_FILE_INFO eof;
+    eof.EndOfFile = size;
+    if (!SetFileInformationByHandle(dst, FileEndOfFileInfo, &eof, sizeof(eof))) {
+        return false;
+    }
+    // only whole clusters can be cloned; the last 
+    // one may reach past the end of the file
+    LONGLONG cluster = integrity.ClusterSizeInBytes;
+    auto end = (size.QuadPart + cluster - 1) / cluster * cluster;
+    for (LONGLONG offset = 0; offset < end; offset += CLONE_CHUNK_SIZE) {
+        DUPLICATE_EXTENTS_DATA data {};
+        data.FileHandle = src;
+        data.SourceFileOffset.QuadPart = offset;
+        data.TargetFileOffset.QuadPart = offset;
+        data.ByteCount.QuadPart = std::min<LONGLONG>(CLONE_CHUNK_SIZE, end - offset);
+        if (!DeviceIoControl(
+            dst, FSCTL_DUPLICATE_EXTENTS_TO_FILE,
+            &data, sizeof(data), nullptr, 0, &bytes, nullptr
+        )) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
+
+static bool reflinkFile(
+    ghc::filesystem::path const& from,
+    ghc::filesystem::path const& to
+) {
+    #if defined(__APPLE__)
+
+    return clonefile(from.c_str(), to.c_str(), 0) == 0;
+
+    #elif defined(__linux__)
+
+    auto src = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (src < 0) {
+        return false;
+    }
+    auto dst = open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (dst < 0) {
+        close(src);
+        return false;
+    }
+    auto cloned = ioctl(dst, FICLONE, src) == 0;
+    close(src);
+    close(dst);
+    if (!cloned) {
+        std::error_code ec;
+        ghc::filesystem::remove(to, ec);
+    }
+    return cloned;
+
+    #elif defined(_WIN32)
+
+    // block cloning, which only ReFS (and with 
+    // it Dev Drives) supports
+    auto src = CreateFileW(
+        from.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (src == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    DWORD flags = 0;
+    if (
+        !GetVolumeInformationByHandleW(src, nullptr, 0, nullptr, nullptr, &flags, nullptr, 0) ||
+        !(flags & FILE_SUPPORTS_BLOCK_REFCOUNTING)
+    ) {
+        CloseHandle(src);
+        return false;
+    }
+    auto dst = CreateFileW(
+        to.wstring().c_str(), GENERIC_READ | GENERIC_WRITE, 0,
+        nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (dst == INVALID_HANDLE_VALUE) {
+        CloseHandle(src);
+        return false;
+    }
+    auto cloned = duplicateExtents(src, dst);
+    CloseHandle(src);
+    CloseHandle(dst);
+    if (!cloned) {
+        std::error_code ec;
+        ghc::filesystem::remove(to, ec);
+    }
+    return cloned;
+
+    #else
+
+    return false;
+
+    #endif
+}
+
+bool canReflink(
+    ghc::filesystem::path const& from,
+    ghc::filesystem::path const& to
+) {
+    #if defined(_WIN32)
+
+    wchar_t fromVolume[MAX_PATH + 1];
+    wchar_t toVolume[MAX_PATH + 1];
+    if (
+        !GetVolumePathNameW(from.wstring().c_str(), fromVolume, MAX_PATH + 1) ||
+        !GetVolumePathNameW(to.wstring().c_str(), toVolume, MAX_PATH + 1) ||
+        _wcsicmp(fromVolume, toVolume) != 0
+    ) {
+        return false;
+    }
+    DWORD flags = 0;
+    if (!GetVolumeInformationW(fromVolume, nullptr, 0, nullptr, nullptr, &flags, nullptr, 0)) {
+        return false;
+    }
+    return flags & FILE_SUPPORTS_BLOCK_REFCOUNTING;
+
+    #elif defined(__APPLE__) || defined(__linux__)
+
+    struct stat fromStat;
+    struct stat toStat;
+    if (
+        stat(from.c_str(), &fromStat) != 0 ||
+        stat(to.c_str(), &toStat) != 0 ||
+        fromStat.st_dev != toStat.st_dev
+    ) {
+        return false;
+    }
+    #ifdef __APPLE__
+    // volume attributes can only be asked 
+    // for at the root of the volume
+    struct statfs fs;
+    if (statfs(from.c_str(), &fs) != 0) {
+        return false;
+    }
+    struct attrlist attrs {};
+    attrs.bitmapcount = ATTR_BIT_MAP_COUNT;
+    attrs.volattr = ATTR_VOL_INFO | ATTR_VOL_CAPABILITIES;
+    struct {
+        uint32_t m_length;
+        vol_capabilities_attr_t m_capabilities;
+    } __attribute__((aligned(4), packed)) result;
+    if (getattrlist(fs.f_mntonname, &attrs, &result, sizeof(result), 0) != 0) {
+        return false;
+    }
+    auto& caps = result.m_capabilities;
+    return
+        caps.valid[VOL_CAPABILITIES_INTERFACES] &
+        caps.capabilities[VOL_CAPABILITIES_INTERFACES] &
+        VOL_CAP_INT_CLONE;
+    #else
+    // there's no asking whether FICLONE works 
+    // short of trying it
+    return true;
+    #endif
+
+    #else
+
+    return false;
+
+    #endif
+}
+
+Result<LinkMode> cloneFile(
+    ghc::filesystem::path const& from,
+    ghc::filesystem::path const& to,
+    bool allowHardlink
+) {
+    if (reflinkFile(from, to)) {
+        return Ok(LinkMode::Reflink);
+    }
+    std::error_code ec;
+    if (allowHardlink) {
+        ghc::filesystem::create_hard_link(from, to, ec);
+        if (!ec) {
+            return Ok(LinkMode::Hardlink);
+        }
+    }
+    ghc::filesystem::copy_file(from, to, ec);
+    if (ec) {
+        return Err("Unable to copy \"" + from.string() + "\": " + ec.message());
+    }
+    return Ok(LinkMode::Copy);
+}
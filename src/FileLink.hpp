@@ -0,0 +1,42 @@
+#pragma once
+
+#include "legacy/filesystem.hpp"
+#include "include/Result.hpp"
+
+/**
+ * How a file ended up sharing (or not
+ * sharing) its data with another
+ */
+enum class LinkMode {
+    Copy,
+    Hardlink,
+    Reflink,
+};
+
+/**
+ * Create to as a copy of from that shares its 
+ * data on disk where possible. A reflink 
+ * (copy-on-write clone) is tried first, which 
+ * behaves exactly like a copy. A hardlink is 
+ * only made if allowHardlink is set, since 
+ * writing to one then changes the other too, 
+ * so neither may ever be written in place. 
+ * to must not exist yet
+ */
+Result<LinkMode> cloneFile(
+    ghc::filesystem::path const& from,
+    ghc::filesystem::path const& to,
+    bool allowHardlink
+);
+
+/**
+ * Whether files in the directory from can be 
+ * reflinked into the directory to: both are 
+ * on the same volume, and its filesystem 
+ * supports reflinks (block cloning on ReFS 
+ * on Windows, APFS on macOS)
+ */
+bool canReflink(
+    ghc::filesystem::path const& from,
+    ghc::filesystem::path const& to
+);
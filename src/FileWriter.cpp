@@ -0,0 +1,211 @@
+#include "FileWriter.hpp"
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <Windows.h>
+#define NO_FILE INVALID_HANDLE_VALUE
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#define NO_FILE -1
+#endif
+
+#define WRITE_BUFFER_SIZE (1024 * 1024)
+// closing files can't be put off forever,
+// there's only so many handles to go around
+#define MAX_PENDING_CLOSES 256
+
+FileWriteBatch::FileWriteBatch(bool sync) : m_sync(sync) {}
+
+FileWriteBatch::~FileWriteBatch() {
+    this->finish();
+}
+
+void FileWriteBatch::close(NativeFile file) {
+    #ifdef _WIN32
+    if (m_sync && !FlushFileBuffers(file) && m_error.empty()) {
+        m_error = "Unable to flush file to disk";
+    }
+    CloseHandle(file);
+    #else
+    if (m_sync && fsync(file) != 0 && m_error.empty()) {
+        m_error = "Unable to flush file to disk";
+    }
+    if (::close(file) != 0 && m_error.empty()) {
+        m_error = "Unable to close file";
+    }
+    #endif
+}
+
+void FileWriteBatch::add(NativeFile file) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_pending.push_back(file);
+    if (m_pending.size() > MAX_PENDING_CLOSES) {
+        this->close(m_pending.front());
+        m_pending.pop_front();
+    }
+}
+
+Result<> FileWriteBatch::finish() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (auto file : m_pending) {
+        this->close(file);
+    }
+    m_pending.clear();
+    if (m_error.size()) {
+        return Err(m_error);
+    }
+    return Ok();
+}
+
+FileWriter::FileWriter() : m_file(NO_FILE) {}
+
+FileWriter::~FileWriter() {
+    this->close();
+}
+
+void FileWriter::close() {
+    if (m_file == NO_FILE) return;
+    #ifdef _WIN32
+    CloseHandle(m_file);
+    #else
+    ::close(m_file);
+    #endif
+    m_file = NO_FILE;
+}
+
+Result<> FileWriter::open(ghc::filesystem::path const& path, uint64_t expectedSize) {
+    this->close();
+    m_path = path;
+    m_buffered = 0;
+    m_written = 0;
+    m_allocated = 0;
+
+    #ifdef _WIN32
+
+    m_file = CreateFileW(
+        path.wstring().c_str(), GENERIC_WRITE, 0, nullptr,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+    );
+    if (m_file == NO_FILE) {
+        return Err("Unable to create file \"" + path.string() + "\"");
+    }
+    if (expectedSize) {
+        FILE_ALLOCATION_INFO info;
+        info.AllocationSize.QuadPart = static_cast<LONGLONG>(expectedSize);
+        if (SetFileInformationByHandle(m_file, FileAllocationInfo, &info, sizeof(info))) {
+            m_allocated = expectedSize;
+        }
+    }
+
+    #else
+
+    m_file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_file == NO_FILE) {
+        return Err("Unable to create file \"" + path.string() + "\"");
+    }
+    if (expectedSize) {
+        #ifdef __APPLE__
+        // try for contiguous space first
+        fstore_t store = {
+            F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE,
+            0, static_cast<off_t>(expectedSize), 0
+        };
+        if (
+            fcntl(m_file, F_PREALLOCATE, &store) != -1 ||
+            (store.fst_flags = F_ALLOCATEALL, fcntl(m_file, F_PREALLOCATE, &store) != -1)
+        ) {
+            m_allocated = expectedSize;
+        }
+        #else
+        if (posix_fallocate(m_file, 0, static_cast<off_t>(expectedSize)) == 0) {
+            m_allocated = expectedSize;
+        }
+        #endif
+    }
+
+    #endif
+
+    // no point in a buffer bigger than the file
+    m_buffer.resize(static_cast<size_t>(
+        std::min<uint64_t>(std::max<uint64_t>(expectedSize, 4096), WRITE_BUFFER_SIZE)
+    ));
+    return Ok();
+}
+
+Result<> FileWriter::writeRaw(uint8_t const* data, size_t size) {
+    while (size) {
+        #ifdef _WIN32
+        DWORD written = 0;
+        auto chunk = static_cast<DWORD>(std::min<size_t>(size, 0x40000000));
+        if (!WriteFile(m_file, data, chunk, &written, nullptr) || !written) {
+            return Err("Unable to write \"" + m_path.string() + "\"");
+        }
+        #else
+        auto written = ::write(m_file, data, size);
+        if (written <= 0) {
+            return Err("Unable to write \"" + m_path.string() + "\"");
+        }
+        #endif
+        data += written;
+        size -= written;
+        m_written += written;
+    }
+    return Ok();
+}
+
+Result<> FileWriter::flush() {
+    if (!m_buffered) {
+        return Ok();
+    }
+    auto res = this->writeRaw(m_buffer.data(), m_buffered);
+    m_buffered = 0;
+    return res;
+}
+
+Result<> FileWriter::write(void const* rawData, size_t size) {
+    auto data = static_cast<uint8_t const*>(rawData);
+    if (m_buffered + size <= m_buffer.size()) {
+        std::memcpy(m_buffer.data() + m_buffered, data, size);
+        m_buffered += size;
+        return Ok();
+    }
+    auto res = this->flush();
+    if (!res) return res;
+    // big writes skip the buffer
+    if (size >= m_buffer.size()) {
+        return this->writeRaw(data, size);
+    }
+    std::memcpy(m_buffer.data(), data, size);
+    m_buffered = size;
+    return Ok();
+}
+
+Result<> FileWriter::finish(FileWriteBatch* batch) {
+    auto res = this->flush();
+    if (!res) {
+        this->close();
+        return res;
+    }
+    // posix_fallocate extends the file, so it has
+    // to be cut down if less was written
+    if (m_allocated > m_written) {
+        #ifdef _WIN32
+        // the allocation is trimmed to the end of
+        // the file when the handle is closed
+        #else
+        if (ftruncate(m_file, static_cast<off_t>(m_written)) != 0) {
+            this->close();
+            return Err("Unable to write \"" + m_path.string() + "\"");
+        }
+        #endif
+    }
+    if (batch) {
+        batch->add(m_file);
+        m_file = NO_FILE;
+    } else {
+        this->close();
+    }
+    return Ok();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "legacy/filesystem.hpp"
+#include "include/Result.hpp"
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <cstdint>
+
+#ifdef _WIN32
+using NativeFile = void*;
+#else
+using NativeFile = int;
+#endif
+
+/**
+ * Closes files written by FileWriters all at
+ * once at the end of an operation, optionally
+ * flushing them to disk first. Closing is slow
+ * on some systems (antivirus scans on Windows)
+ * and flushing every file as it's written
+ * would make the disk seek back and forth.
+ * Thread-safe
+ */
+class FileWriteBatch {
+protected:
+    std::mutex m_lock;
+    std::deque<NativeFile> m_pending;
+    bool m_sync;
+    std::string m_error;
+
+    void close(NativeFile file);
+
+public:
+    FileWriteBatch(bool sync);
+    ~FileWriteBatch();
+
+    void add(NativeFile file);
+    /**
+     * Flush (if enabled) and close every file
+     * added so far
+     */
+    Result<> finish();
+};
+
+/**
+ * Writes a file through a large buffer, after
+ * preallocating the space it's expected to take
+ * so the filesystem can lay it out in one piece
+ */
+class FileWriter {
+protected:
+    ghc::filesystem::path m_path;
+    NativeFile m_file;
+    std::vector<uint8_t> m_buffer;
+    size_t m_buffered = 0;
+    uint64_t m_written = 0;
+    uint64_t m_allocated = 0;
+
+    Result<> writeRaw(uint8_t const* data, size_t size);
+    Result<> flush();
+    void close();
+
+public:
+    FileWriter();
+    ~FileWriter();
+
+    FileWriter(FileWriter const&) = delete;
+    FileWriter& operator=(FileWriter const&) = delete;
+
+    Result<> open(ghc::filesystem::path const& path, uint64_t expectedSize);
+    Result<> write(void const* data, size_t size);
+    /**
+     * Write out the rest of the buffer. If a batch
+     * is given, closing the file is left to it
+     */
+    Result<> finish(FileWriteBatch* batch = nullptr);
+};
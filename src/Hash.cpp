@@ -0,0 +1,121 @@
+#include "Hash.hpp"
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+
+static constexpr uint32_t ROUND_CONSTANTS[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t rotr(uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+Sha256::Sha256() {
+    this->reset();
+}
+
+void Sha256::reset() {
+    static constexpr uint32_t INITIAL_STATE[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    std::memcpy(m_state, INITIAL_STATE, sizeof(m_state));
+    m_blockSize = 0;
+    m_length = 0;
+}
+
+void Sha256::transform(uint8_t const* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] =
+            (static_cast<uint32_t>(block[i * 4]) << 24) |
+            (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+            (static_cast<uint32_t>(block[i * 4 + 2]) << 8) |
+            static_cast<uint32_t>(block[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; i++) {
+        auto s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        auto s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+    auto e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+    for (int i = 0; i < 64; i++) {
+        auto s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        auto ch = (e & f) ^ (~e & g);
+        auto t1 = h + s1 + ch + ROUND_CONSTANTS[i] + w[i];
+        auto s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        auto maj = (a & b) ^ (a & c) ^ (b & c);
+        auto t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    m_state[0] += a; m_state[1] += b; m_state[2] += c; m_state[3] += d;
+    m_state[4] += e; m_state[5] += f; m_state[6] += g; m_state[7] += h;
+}
+
+void Sha256::update(void const* rawData, size_t size) {
+    auto data = static_cast<uint8_t const*>(rawData);
+    m_length += size;
+    if (m_blockSize) {
+        auto take = std::min<size_t>(size, sizeof(m_block) - m_blockSize);
+        std::memcpy(m_block + m_blockSize, data, take);
+        m_blockSize += take;
+        data += take;
+        size -= take;
+        if (m_blockSize < sizeof(m_block)) return;
+        this->transform(m_block);
+        m_blockSize = 0;
+    }
+    while (size >= sizeof(m_block)) {
+        this->transform(data);
+        data += sizeof(m_block);
+        size -= sizeof(m_block);
+    }
+    std::memcpy(m_block, data, size);
+    m_blockSize = size;
+}
+
+std::string Sha256::finish() {
+    auto bits = m_length * 8;
+    uint8_t padding[72] = { 0x80 };
+    auto padSize = (m_blockSize < 56 ? 56 : 120) - m_blockSize;
+    for (int i = 0; i < 8; i++) {
+        padding[padSize + i] = static_cast<uint8_t>(bits >> (56 - i * 8));
+    }
+    this->update(padding, padSize + 8);
+
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::string res;
+    for (auto word : m_state) {
+        for (int i = 24; i >= 0; i -= 8) {
+            auto byte = static_cast<uint8_t>(word >> i);
+            res += HEX[byte >> 4];
+            res += HEX[byte & 0xf];
+        }
+    }
+    return res;
+}
+
+bool digestsMatch(std::string const& a, std::string const& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::tolower(a[i]) != std::tolower(b[i])) return false;
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Incremental SHA-256, fed with data as it
+ * arrives so verifying a download doesn't
+ * take another pass over the file
+ */
+class Sha256 {
+protected:
+    uint32_t m_state[8];
+    uint8_t m_block[64];
+    size_t m_blockSize = 0;
+    uint64_t m_length = 0;
+
+    void transform(uint8_t const* block);
+
+public:
+    Sha256();
+
+    void reset();
+    void update(void const* data, size_t size);
+    /**
+     * Finish the hash and return it as lowercase
+     * hex. The hasher has to be reset to be used
+     * again afterwards
+     */
+    std::string finish();
+};
+
+/**
+ * Compare two hex digests, ignoring case
+ */
+bool digestsMatch(std::string const& a, std::string const& b);
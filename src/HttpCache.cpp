@@ -0,0 +1,115 @@
+#include "HttpCache.hpp"
+#include "include/json.hpp"
+#include <fstream>
+#include <cstdio>
+
+static std::string hashURL(std::string const& url) {
+    // FNV-1a; just needs to be stable across runs
+    uint64_t hash = 0xcbf29ce484222325;
+    for (auto c : url) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash));
+    return buf;
+}
+
+bool CachedResponse::isFresh(std::chrono::seconds maxAge) const {
+    return
+        maxAge.count() > 0 &&
+        std::chrono::system_clock::now() - m_fetched < maxAge;
+}
+
+void HttpCache::setDirectory(ghc::filesystem::path const& directory) {
+    m_directory = directory;
+}
+
+ghc::filesystem::path HttpCache::getEntryPath(std::string const& url) const {
+    return m_directory / hashURL(url);
+}
+
+ghc::filesystem::path HttpCache::getPartPath(std::string const& url) const {
+    auto path = this->getEntryPath(url);
+    path += ".body.part";
+    return path;
+}
+
+tl::optional<CachedResponse> HttpCache::get(std::string const& url) const {
+    auto path = this->getEntryPath(url);
+    auto meta = path;
+    meta += ".json";
+    auto body = path;
+    body += ".body";
+    try {
+        if (!ghc::filesystem::exists(meta) || !ghc::filesystem::exists(body)) {
+            return tl::nullopt;
+        }
+        std::ifstream ifs(meta);
+        auto json = nlohmann::json::parse(ifs);
+        // hash collision
+        if (json["url"].get<std::string>() != url) {
+            return tl::nullopt;
+        }
+        CachedResponse entry;
+        entry.m_url = url;
+        entry.m_etag = json["etag"].get<std::string>();
+        entry.m_lastModified = json["last-modified"].get<std::string>();
+        entry.m_fetched = std::chrono::system_clock::time_point(
+            std::chrono::seconds(json["fetched"].get<int64_t>())
+        );
+        entry.m_body = body;
+        return entry;
+    } catch(std::exception&) {
+        return tl::nullopt;
+    }
+}
+
+Result<> HttpCache::saveEntry(CachedResponse const& entry) const {
+    auto meta = this->getEntryPath(entry.m_url);
+    meta += ".json";
+
+    nlohmann::json json;
+    json["url"] = entry.m_url;
+    json["etag"] = entry.m_etag;
+    json["last-modified"] = entry.m_lastModified;
+    json["fetched"] = std::chrono::duration_cast<std::chrono::seconds>(
+        entry.m_fetched.time_since_epoch()
+    ).count();
+
+    std::ofstream ofs(meta);
+    if (!ofs.is_open()) {
+        return Err("Unable to write cache entry \"" + meta.string() + "\"");
+    }
+    ofs << json.dump(4);
+    return Ok();
+}
+
+Result<CachedResponse> HttpCache::store(
+    std::string const& url,
+    std::string const& etag,
+    std::string const& lastModified
+) {
+    CachedResponse entry;
+    entry.m_url = url;
+    entry.m_etag = etag;
+    entry.m_lastModified = lastModified;
+    entry.m_fetched = std::chrono::system_clock::now();
+    entry.m_body = this->getEntryPath(url);
+    entry.m_body += ".body";
+    try {
+        ghc::filesystem::rename(this->getPartPath(url), entry.m_body);
+    } catch(std::exception& e) {
+        return Err("Unable to store response: " + std::string(e.what()));
+    }
+    auto res = this->saveEntry(entry);
+    if (!res) {
+        return Err(res.error());
+    }
+    return Ok(entry);
+}
+
+void HttpCache::touch(CachedResponse& entry) const {
+    entry.m_fetched = std::chrono::system_clock::now();
+    this->saveEntry(entry);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "legacy/filesystem.hpp"
+#include "legacy/optional.hpp"
+#include "include/Result.hpp"
+#include <string>
+#include <chrono>
+
+/**
+ * A response body stored on disk together
+ * with the validators it was served with
+ */
+struct CachedResponse {
+    std::string m_url;
+    std::string m_etag;
+    std::string m_lastModified;
+    std::chrono::system_clock::time_point m_fetched;
+    ghc::filesystem::path m_body;
+
+    /**
+     * Whether the response was fetched less than
+     * maxAge ago, so it can be used without even
+     * asking the server. A max age of zero means
+     * the response always has to be revalidated
+     */
+    bool isFresh(std::chrono::seconds maxAge) const;
+};
+
+/**
+ * On-disk cache of GET responses, used to send
+ * conditional requests (If-None-Match and
+ * If-Modified-Since) and serve 304s from disk
+ */
+class HttpCache {
+protected:
+    ghc::filesystem::path m_directory;
+
+    ghc::filesystem::path getEntryPath(std::string const& url) const;
+    Result<> saveEntry(CachedResponse const& entry) const;
+
+public:
+    void setDirectory(ghc::filesystem::path const& directory);
+
+    tl::optional<CachedResponse> get(std::string const& url) const;
+    /**
+     * Path where a new body for the URL should
+     * be written to before calling store()
+     */
+    ghc::filesystem::path getPartPath(std::string const& url) const;
+    Result<CachedResponse> store(
+        std::string const& url,
+        std::string const& etag,
+        std::string const& lastModified
+    );
+    /**
+     * Mark the entry as fetched now, after the
+     * server confirmed it's still valid
+     */
+    void touch(CachedResponse& entry) const;
+};
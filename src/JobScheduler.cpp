@@ -0,0 +1,209 @@
+#include "JobScheduler.hpp"
+#include <algorithm>
+
+struct JobScheduler::TaskGroup {
+    std::function<void(size_t)> m_func;
+    std::atomic<size_t> m_remaining;
+    std::mutex m_lock;
+    std::condition_variable m_done;
+
+    TaskGroup(std::function<void(size_t)> func, size_t count)
+      : m_func(std::move(func)), m_remaining(count) {}
+};
+
+// which scheduler (if any) the current thread
+// is a worker of, and its index in there
+static thread_local JobScheduler* t_scheduler = nullptr;
+static thread_local size_t t_workerIndex = 0;
+
+JobScheduler::JobScheduler(size_t threads) {
+    m_threadCount = threads ?
+        threads :
+        std::max<size_t>(2, std::thread::hardware_concurrency());
+    for (size_t i = 0; i <= m_threadCount; i++) {
+        m_taskQueues.push_back(std::make_unique<TaskQueue>());
+    }
+}
+
+JobScheduler::~JobScheduler() {
+    this->shutdown();
+}
+
+size_t JobScheduler::getThreadCount() const {
+    return m_threadCount;
+}
+
+void JobScheduler::start() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_stopping || m_threads.size()) {
+        return;
+    }
+    for (size_t i = 0; i < m_threadCount; i++) {
+        m_threads.emplace_back(&JobScheduler::runWorker, this, i);
+    }
+}
+
+JobScheduler::TaskQueue& JobScheduler::getOwnQueue() {
+    if (t_scheduler == this) {
+        return *m_taskQueues.at(t_workerIndex);
+    }
+    return *m_taskQueues.back();
+}
+
+bool JobScheduler::popOwnTask(Task& task) {
+    auto& queue = this->getOwnQueue();
+    std::lock_guard<std::mutex> lock(queue.m_lock);
+    if (queue.m_tasks.empty()) {
+        return false;
+    }
+    // newest first; it's the smallest piece
+    // and its data is likely still in cache
+    task = std::move(queue.m_tasks.back());
+    queue.m_tasks.pop_back();
+    m_queuedTasks--;
+    return true;
+}
+
+bool JobScheduler::stealTask(Task& task) {
+    auto start = t_scheduler == this ? t_workerIndex + 1 : 0;
+    for (size_t i = 0; i < m_taskQueues.size(); i++) {
+        auto& queue = *m_taskQueues.at((start + i) % m_taskQueues.size());
+        std::lock_guard<std::mutex> lock(queue.m_lock);
+        if (queue.m_tasks.empty()) {
+            continue;
+        }
+        // oldest first; it's the biggest piece
+        task = std::move(queue.m_tasks.front());
+        queue.m_tasks.pop_front();
+        m_queuedTasks--;
+        return true;
+    }
+    return false;
+}
+
+void JobScheduler::runTask(Task& task) {
+    auto begin = task.m_begin;
+    auto end = task.m_end;
+    // split the range in halves, leaving the far
+    // halves for other threads to steal. A task
+    // that doesn't get stolen is just picked up
+    // again by this thread
+    auto& queue = this->getOwnQueue();
+    while (end - begin > 1) {
+        auto mid = begin + (end - begin) / 2;
+        {
+            std::lock_guard<std::mutex> lock(queue.m_lock);
+            queue.m_tasks.push_back({ task.m_group, mid, end });
+            m_queuedTasks++;
+        }
+        // so a worker can't miss the wakeup between
+        // checking for tasks and going to sleep
+        { std::lock_guard<std::mutex> lock(m_lock); }
+        m_wake.notify_one();
+        end = mid;
+    }
+    for (auto i = begin; i < end; i++) {
+        task.m_group->m_func(i);
+    }
+    if (task.m_group->m_remaining.fetch_sub(end - begin) == end - begin) {
+        std::lock_guard<std::mutex> lock(task.m_group->m_lock);
+        task.m_group->m_done.notify_all();
+    }
+}
+
+void JobScheduler::runWorker(size_t index) {
+    t_scheduler = this;
+    t_workerIndex = index;
+    while (true) {
+        Task task;
+        if (this->popOwnTask(task) || this->stealTask(task)) {
+            this->runTask(task);
+            continue;
+        }
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_wake.wait(lock, [this]() -> bool {
+                return m_stopping || m_queuedTasks > 0 || std::any_of(
+                    std::begin(m_jobs), std::end(m_jobs), [](auto const& jobs) {
+                        return jobs.size();
+                    }
+                );
+            });
+            // tasks belong to jobs that are already
+            // running, so they're finished first
+            if (m_queuedTasks > 0) {
+                continue;
+            }
+            for (auto& jobs : m_jobs) {
+                if (jobs.size()) {
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                    break;
+                }
+            }
+            if (!job && m_stopping) {
+                return;
+            }
+        }
+        if (job) job();
+    }
+}
+
+bool JobScheduler::submit(Job job, JobPriority priority) {
+    this->start();
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_stopping) {
+            return false;
+        }
+        m_jobs[static_cast<size_t>(priority)].push_back(std::move(job));
+    }
+    m_wake.notify_one();
+    return true;
+}
+
+void JobScheduler::parallelFor(size_t count, std::function<void(size_t)> func) {
+    if (!count) {
+        return;
+    }
+    this->start();
+    auto group = std::make_shared<TaskGroup>(std::move(func), count);
+    Task task { group, 0, count };
+    this->runTask(task);
+    // whatever's left on our own queue wasn't stolen,
+    // so it's up to us; once that's done the rest are
+    // being worked on by other threads
+    while (group->m_remaining > 0) {
+        Task own;
+        if (this->popOwnTask(own)) {
+            this->runTask(own);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(group->m_lock);
+        group->m_done.wait(lock, [&group]() -> bool {
+            return group->m_remaining == 0;
+        });
+    }
+}
+
+void JobScheduler::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+        for (auto& jobs : m_jobs) {
+            jobs.clear();
+        }
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) {
+        // a job shutting down the scheduler can't
+        // wait for itself to finish
+        if (thread.get_id() == std::this_thread::get_id()) {
+            thread.detach();
+        } else if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    m_threads.clear();
+}
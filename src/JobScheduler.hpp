@@ -0,0 +1,104 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/**
+ * Jobs of higher priority are started first.
+ * Metadata work (small files, index updates)
+ * should go before bulk I/O, so the UI has
+ * something to show early
+ */
+enum class JobPriority {
+    High,
+    Normal,
+    Bulk,
+};
+
+using Job = std::function<void()>;
+
+/**
+ * A fixed pool of worker threads that long
+ * operations are submitted to, instead of each
+ * of them starting a thread of its own.
+ *
+ * Jobs can split their work into fine-grained
+ * tasks with parallelFor. Tasks go on the deque
+ * of the thread that created them, and workers
+ * that run out of work steal from the others,
+ * so a job with lots of small files spreads
+ * over every idle worker. Thread-safe
+ */
+class JobScheduler {
+protected:
+    struct TaskGroup;
+
+    struct Task {
+        std::shared_ptr<TaskGroup> m_group;
+        size_t m_begin;
+        size_t m_end;
+    };
+
+    struct TaskQueue {
+        std::mutex m_lock;
+        std::deque<Task> m_tasks;
+    };
+
+    size_t m_threadCount;
+    std::vector<std::thread> m_threads;
+    // one per worker, plus one shared by
+    // callers from outside the pool
+    std::vector<std::unique_ptr<TaskQueue>> m_taskQueues;
+    std::deque<Job> m_jobs[3];
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_queuedTasks = 0;
+    bool m_stopping = false;
+
+    void start();
+    void runWorker(size_t index);
+    TaskQueue& getOwnQueue();
+    bool popOwnTask(Task& task);
+    bool stealTask(Task& task);
+    void runTask(Task& task);
+
+public:
+    /**
+     * Create a pool of the given amount
+     * of threads (0 = one per core). The
+     * threads are started on first use
+     */
+    JobScheduler(size_t threads = 0);
+    ~JobScheduler();
+
+    JobScheduler(JobScheduler const&) = delete;
+    JobScheduler& operator=(JobScheduler const&) = delete;
+
+    size_t getThreadCount() const;
+
+    /**
+     * Queue a job. Returns false if the
+     * scheduler has been shut down
+     */
+    bool submit(Job job, JobPriority priority = JobPriority::Normal);
+    /**
+     * Run func for every index in [0, count) on
+     * the pool, returning once all of them are
+     * done. The calling thread works on the tasks
+     * too, so this can be called from within
+     * a job without tying up a worker
+     */
+    void parallelFor(size_t count, std::function<void(size_t)> func);
+    /**
+     * Drop the jobs that haven't started yet,
+     * wait for the running ones to finish and
+     * stop the workers
+     */
+    void shutdown();
+};
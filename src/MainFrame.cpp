@@ -69,6 +69,7 @@ void MainFrame::onClose(wxCloseEvent& event) {
             return event.Veto();
         }
     }
+    Manager::get()->shutdown();
     event.Skip();
 }
 
@@ -203,6 +204,22 @@ void MainFrame::selectPageStructure(InstallType type) {
             };
         } break;
     }
+
+    // get the downloads going while the user 
+    // reads through the first pages
+    switch (type) {
+        case InstallType::Install:
+        case InstallType::InstallOnGDPS: {
+            Manager::get()->prefetchReleaseData();
+            Manager::get()->prefetchGeodeUtilsLib(DevBranch::Stable);
+        } break;
+
+        case InstallType::InstallDevTools: {
+            Manager::get()->prefetchReleaseData();
+        } break;
+
+        default: break;
+    }
 }
 
 MainFrame::MainFrame() : wxFrame(
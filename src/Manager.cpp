@@ -1,16 +1,44 @@
 #include "Manager.hpp"
+#include "Download.hpp"
+#include "Zip.hpp"
+#include "Archive.hpp"
+#include "ReleaseInfo.hpp"
 #include <fstream>
 #include "objc.h"
-#include <wx/zipstrm.h>
 #include <wx/wfstream.h>
 #include <wx/stdpaths.h>
 #include <thread>
+#include <mutex>
 #include <chrono>
 #include <algorithm>
 
 #define INSTALL_DATA_JSON "config.json"
 #define GEODE_DIR "Geode"
 #define GEODE_SUITE_ENV "GEODE_SUITE"
+#define DOWNLOADS_DIR "downloads"
+#define CACHE_DIR "cache"
+#define STORE_DIR "store"
+// the CLI is extracted next to the bin directory 
+// and swapped in, keeping the old one for rollback
+#define STAGING_SUFFIX ".staging"
+#define PREVIOUS_SUFFIX ".prev"
+// the version of the previous CLI, as the config 
+// only knows about the current one
+#define PREVIOUS_VERSION_SUFFIX ".prev-version"
+// how often progress reported by worker 
+// threads is shown, about once per frame
+#define PROGRESS_INTERVAL_MS 16
+// conditional requests are cheap (and don't count
+// against GitHub's API rate limit), so cached
+// responses are only trusted blindly for a bit
+#define RELEASE_MAX_AGE std::chrono::minutes(5)
+#define VERSIONS_MAX_AGE std::chrono::minutes(1)
+// release assets never change once published, but
+// the utils library is served from a branch
+#define RELEASE_ASSET_MAX_AGE std::chrono::hours(24 * 30)
+#define UTILS_LIB_MAX_AGE std::chrono::hours(1)
+
+#define CLI_RELEASE_URL "https://api.github.com/repos/geode-sdk/cli/releases/latest"
 
 #ifdef _WIN32
 
@@ -20,6 +48,7 @@
 
 #define PLATFORM_ASSET_IDENTIFIER "win"
 #define PLATFORM_NAME "Windows"
+#define UTILS_LIB_NAME "geodeutils.dll"
 
 #elif defined(__APPLE__)
 
@@ -28,6 +57,7 @@
 #include "objc.h"
 #define PLATFORM_ASSET_IDENTIFIER "mac"
 #define PLATFORM_NAME "MacOS"
+#define UTILS_LIB_NAME "libgeodeutils.dylib"
 
 #else
 #warning "Define PLATFORM_ASSET_IDENTIFIER & PLATFORM_NAME"
@@ -44,6 +74,52 @@ void Manager::onSyncThreadCall(CallOnMainEvent& e) {
     e.invoke();
 }
 
+void Manager::watchProgress(std::shared_ptr<ProgressSlot> slot, DownloadProgressFunc func) {
+    m_progressSlots.push_back({ slot, func });
+    if (!m_progressTimer.IsRunning()) {
+        m_progressTimer.Start(PROGRESS_INTERVAL_MS);
+    }
+}
+
+void Manager::unwatchProgress(std::shared_ptr<ProgressSlot> const& slot) {
+    auto it = std::find_if(m_progressSlots.begin(), m_progressSlots.end(), [&](auto const& watched) {
+        return watched.first == slot;
+    });
+    if (it == m_progressSlots.end()) return;
+    auto func = it->second;
+    m_progressSlots.erase(it);
+    if (m_progressSlots.empty()) {
+        m_progressTimer.Stop();
+    }
+    std::string text;
+    int percent;
+    if (slot->take(text, percent) && func) {
+        func(text, percent);
+    }
+}
+
+void Manager::onProgressTimer(wxTimerEvent&) {
+    m_progressSlots.erase(
+        std::remove_if(m_progressSlots.begin(), m_progressSlots.end(), [](auto const& watched) {
+            return watched.first.use_count() == 1;
+        }),
+        m_progressSlots.end()
+    );
+    // copied since the callbacks may well watch 
+    // or unwatch other slots
+    auto slots = m_progressSlots;
+    std::string text;
+    int percent;
+    for (auto& [slot, func] : slots) {
+        if (slot->take(text, percent) && func) {
+            func(text, percent);
+        }
+    }
+    if (m_progressSlots.empty()) {
+        m_progressTimer.Stop();
+    }
+}
+
 void Manager::addInstallation(Installation const& inst) {
     auto old = std::find(m_installations.begin(), m_installations.end(), inst);
     if (old != m_installations.end()) {
@@ -89,156 +165,738 @@ ghc::filesystem::path const& Manager::getLoaderUpdatePath() const {
 }
 
 
-void Manager::webRequest(
+Manager::Manager() {
+    this->Bind(CALL_ON_MAIN, &Manager::onSyncThreadCall, this);
+    m_progressTimer.SetOwner(this);
+    this->Bind(wxEVT_TIMER, &Manager::onProgressTimer, this);
+    this->Bind(wxEVT_WEBREQUEST_STATE, &Manager::onWebRequestState, this);
+    this->Bind(wxEVT_WEBREQUEST_DATA, &Manager::onWebRequestData, this);
+}
+
+void Manager::onWebRequestState(wxWebRequestEvent& evt) {
+    auto it = m_webRequests.find(evt.GetId());
+    if (it == m_webRequests.end()) {
+        return evt.Skip();
+    }
+    // keep the handler alive even if the map 
+    // gets modified by the callback
+    auto handler = it->second;
+    auto finished = false;
+    switch (evt.GetState()) {
+        case wxWebRequest::State_Unauthorized: {
+            // we never provide credentials, so 
+            // the request won't go anywhere
+            finished = true;
+            handler->m_request.Cancel();
+        } break;
+
+        case wxWebRequest::State_Completed:
+        case wxWebRequest::State_Failed:
+        case wxWebRequest::State_Cancelled: {
+            finished = true;
+        } break;
+
+        default: break;
+    }
+    if (finished) {
+        m_webRequests.erase(it);
+        if (handler->m_cancelToken) {
+            handler->m_cancelToken->removeCallback(handler->m_cancelCallback);
+        }
+    }
+    if (handler->m_stateFunc) handler->m_stateFunc(evt);
+}
+
+void Manager::onWebRequestData(wxWebRequestEvent& evt) {
+    auto it = m_webRequests.find(evt.GetId());
+    if (it == m_webRequests.end()) {
+        return evt.Skip();
+    }
+    auto handler = it->second;
+    if (handler->m_dataFunc) handler->m_dataFunc(evt);
+}
+
+wxWebRequest Manager::createWebRequest(
     std::string const& url,
-    bool downloadFile,
+    WebRequestStateFunc stateFunc,
+    WebRequestDataFunc dataFunc,
+    std::shared_ptr<CancelToken> const& cancelToken
+) {
+    if (cancelToken && cancelToken->isCancelled()) {
+        return wxWebRequest();
+    }
+    auto id = m_nextWebRequestID++;
+    auto request = wxWebSession::GetDefault().CreateRequest(this, url, id);
+    if (request.IsOk()) {
+        auto handler = std::make_shared<WebRequestHandler>();
+        handler->m_request = request;
+        handler->m_stateFunc = stateFunc;
+        handler->m_dataFunc = dataFunc;
+        if (cancelToken) {
+            handler->m_cancelToken = cancelToken;
+            handler->m_cancelCallback = cancelToken->onCancel([request]() mutable -> void {
+                if (
+                    request.GetState() == wxWebRequest::State_Idle ||
+                    request.GetState() == wxWebRequest::State_Active
+                ) {
+                    request.Cancel();
+                }
+            });
+        }
+        m_webRequests.insert({ id, handler });
+    }
+    return request;
+}
+
+bool Manager::joinInFlight(std::string const& key, InFlightWaiter const& waiter) {
+    auto it = m_inFlight.find(key);
+    if (it != m_inFlight.end()) {
+        it->second.push_back(waiter);
+        return true;
+    }
+    m_inFlight.insert({ key, { waiter } });
+    return false;
+}
+
+void Manager::progressInFlight(std::string const& key, std::string const& text, int progress) {
+    auto it = m_inFlight.find(key);
+    if (it == m_inFlight.end()) return;
+    // copy in case a callback joins or finishes
+    auto waiters = it->second;
+    for (auto& waiter : waiters) {
+        if (waiter.m_progressFunc) waiter.m_progressFunc(text, progress);
+    }
+}
+
+void Manager::finishInFlight(std::string const& key, ghc::filesystem::path const& path) {
+    auto it = m_inFlight.find(key);
+    if (it == m_inFlight.end()) return;
+    // take the waiters out first so callbacks can 
+    // start a new operation with the same key
+    auto waiters = std::move(it->second);
+    m_inFlight.erase(it);
+    for (auto& waiter : waiters) {
+        if (waiter.m_finishFunc) waiter.m_finishFunc(path);
+    }
+}
+
+void Manager::failInFlight(std::string const& key, std::string const& error) {
+    auto it = m_inFlight.find(key);
+    if (it == m_inFlight.end()) return;
+    auto waiters = std::move(it->second);
+    m_inFlight.erase(it);
+    for (auto& waiter : waiters) {
+        if (waiter.m_errorFunc) waiter.m_errorFunc(error);
+    }
+}
+
+void Manager::fetchFile(
+    std::string const& url,
+    std::chrono::seconds maxAge,
     DownloadErrorFunc errorFunc,
-    DownloadProgressFunc progressFunc,
-    DownloadFinishFunc finishFunc
+    DownloadFileFinishFunc finishFunc
 ) {
-    auto request = wxWebSession::GetDefault().CreateRequest(this, url);
-    if (!request.IsOk()) {
+    auto cached = m_httpCache.get(url);
+    if (cached && cached.value().isFresh(maxAge)) {
+        auto body = cached.value().m_body;
+        this->CallAfter([finishFunc, body]() -> void {
+            if (finishFunc) finishFunc(body);
+        });
+        return;
+    }
+
+    // everyone asking for the same URL while a 
+    // request for it is in flight gets its response
+    auto key = "fetch " + url;
+    if (this->joinInFlight(key, { errorFunc, nullptr, finishFunc })) {
+        return;
+    }
+    errorFunc = [this, key](std::string const& error) -> void {
+        this->failInFlight(key, error);
+    };
+    finishFunc = [this, key](ghc::filesystem::path const& body) -> void {
+        this->finishInFlight(key, body);
+    };
+
+    auto partPath = m_httpCache.getPartPath(url);
+    auto file = std::make_shared<wxFile>();
+    try {
+        if (!ghc::filesystem::exists(partPath.parent_path())) {
+            ghc::filesystem::create_directories(partPath.parent_path());
+        }
+    } catch(std::exception&) {}
+    if (!file->Create(partPath.wstring(), true)) {
         if (!errorFunc) return;
-        return errorFunc("Unable to create web request");
-    }
-    if (downloadFile) {
-        request.SetStorage(wxWebRequest::Storage_File);
-    }
-    this->Bind(
-        wxEVT_WEBREQUEST_STATE,
-        [errorFunc, progressFunc, finishFunc](wxWebRequestEvent& evt) -> void {
-        switch (evt.GetState()) {
-            case wxWebRequest::State_Completed: {
-                auto res = evt.GetResponse();
-                if (!res.IsOk()) {
-                    if (!errorFunc) return;
-                    return errorFunc("Web request returned not OK");
-                }
-                if (res.GetStatus() != 200) {
-                    if (!errorFunc) return;
-                    return errorFunc("Web request returned " + std::to_string(res.GetStatus()));
-                }
-                if (finishFunc) finishFunc(res);
-            } break;
+        return errorFunc("Unable to create file \"" + partPath.string() + "\"");
+    }
 
-            case wxWebRequest::State_Active: {
-                if (!progressFunc) return;
-                if (evt.GetRequest().GetBytesExpectedToReceive() == -1) {
-                    return progressFunc("Beginning download", 0);
-                }
-                progressFunc(
-                    "Downloading",
-                    static_cast<int>(
-                        static_cast<double>(evt.GetRequest().GetBytesReceived()) /
-                        evt.GetRequest().GetBytesExpectedToReceive() * 100.0
-                    )
-                );
-            } break;
+    auto discard = [file, partPath]() -> void {
+        if (file->IsOpened()) file->Close();
+        std::error_code ec;
+        ghc::filesystem::remove(partPath, ec);
+    };
+    auto fail = [errorFunc, discard](std::string const& msg) -> void {
+        discard();
+        if (errorFunc) errorFunc(msg);
+    };
+
+    auto request = this->createWebRequest(
+        url,
+        [this, url, cached, file, discard, fail, finishFunc](wxWebRequestEvent& evt) -> void {
+            switch (evt.GetState()) {
+                case wxWebRequest::State_Completed: {
+                    auto res = evt.GetResponse();
+                    if (!res.IsOk()) {
+                        return fail("Web request returned not OK");
+                    }
+                    if (res.GetStatus() == 304 && cached) {
+                        auto entry = cached.value();
+                        discard();
+                        m_httpCache.touch(entry);
+                        if (finishFunc) finishFunc(entry.m_body);
+                        return;
+                    }
+                    if (res.GetStatus() != 200) {
+                        return fail("Web request returned " + std::to_string(res.GetStatus()));
+                    }
+                    if (!file->IsOpened()) {
+                        return fail("Unable to write response to disk");
+                    }
+                    file->Close();
+                    auto entry = m_httpCache.store(
+                        url,
+                        res.GetHeader("ETag").ToStdString(),
+                        res.GetHeader("Last-Modified").ToStdString()
+                    );
+                    if (!entry) {
+                        return fail(entry.error());
+                    }
+                    if (finishFunc) finishFunc(entry.value().m_body);
+                } break;
 
-            case wxWebRequest::State_Idle: {
-                if (progressFunc) progressFunc("Waiting", 0);
-            } break;
+                case wxWebRequest::State_Unauthorized: {
+                    fail("Unauthorized to do web request");
+                } break;
 
-            case wxWebRequest::State_Unauthorized: {
-                if (errorFunc) errorFunc("Unauthorized to do web request");
-            } break;
+                case wxWebRequest::State_Failed: {
+                    fail("Web request failed");
+                } break;
 
-            case wxWebRequest::State_Failed: {
-                if (errorFunc) errorFunc("Web request failed");
-            } break;
+                case wxWebRequest::State_Cancelled: {
+                    fail("Web request cancelled");
+                } break;
 
-            case wxWebRequest::State_Cancelled: {
-                if (errorFunc) errorFunc("Web request cancelled");
-            } break;
+                default: break;
+            }
+        },
+        [file](wxWebRequestEvent& evt) -> void {
+            if (!file->IsOpened()) return;
+            if (file->Write(evt.GetDataBuffer(), evt.GetDataSize()) != evt.GetDataSize()) {
+                file->Close();
+            }
+        },
+        m_cancelToken
+    );
+    if (!request.IsOk()) {
+        return fail("Unable to create web request");
+    }
+    if (cached) {
+        if (cached.value().m_etag.size()) {
+            request.SetHeader("If-None-Match", cached.value().m_etag);
         }
-    });
+        if (cached.value().m_lastModified.size()) {
+            request.SetHeader("If-Modified-Since", cached.value().m_lastModified);
+        }
+    }
+    request.SetStorage(wxWebRequest::Storage_None);
     request.Start();
 }
 
-Result<> Manager::unzipTo(
-    ghc::filesystem::path const& zipLocation,
-    ghc::filesystem::path const& targetLocation
+void Manager::fetch(
+    std::string const& url,
+    std::chrono::seconds maxAge,
+    DownloadErrorFunc errorFunc,
+    FetchFinishFunc finishFunc
 ) {
-    wxFileInputStream fis(zipLocation.wstring());
-    if (!fis.IsOk()) {
-        return Err("Unable to open zip");
+    this->fetchFile(
+        url, maxAge, errorFunc,
+        [errorFunc, finishFunc](ghc::filesystem::path const& body) -> void {
+            std::ifstream ifs(body, std::ios::binary);
+            if (!ifs.is_open()) {
+                if (errorFunc) errorFunc("Unable to read cached response");
+                return;
+            }
+            std::string data(
+                (std::istreambuf_iterator<char>(ifs)),
+                std::istreambuf_iterator<char>()
+            );
+            if (finishFunc) finishFunc(data);
+        }
+    );
+}
+
+void Manager::downloadFile(
+    std::string const& url,
+    ghc::filesystem::path const& target,
+    DownloadErrorFunc errorFunc,
+    DownloadProgressFunc progressFunc,
+    DownloadFileFinishFunc finishFunc,
+    std::string const& sha256
+) {
+    auto key = "download " + url + " " + target.string();
+
+    // a prefetched copy is moved into place
+    // instead of downloading the file again. It
+    // wasn't checked against any checksum though,
+    // so it's only used when none is asked for
+    auto prefetched = m_prefetched.find(url);
+    if (sha256.empty() && prefetched != m_prefetched.end()) {
+        auto from = prefetched->second;
+        auto prefetchKey = "download " + url + " " + from.string();
+        auto place = [this, url, from, target, errorFunc, finishFunc](
+            ghc::filesystem::path const&
+        ) -> void {
+            m_prefetched.erase(url);
+            auto res = placeFile(from, target);
+            if (!res) {
+                if (errorFunc) errorFunc(res.error());
+                return;
+            }
+            if (finishFunc) finishFunc(target);
+        };
+        if (m_inFlight.count(prefetchKey)) {
+            this->joinInFlight(prefetchKey, { errorFunc, progressFunc, place });
+            return;
+        }
+        if (ghc::filesystem::exists(from)) {
+            this->CallAfter([progressFunc, place, from]() -> void {
+                if (progressFunc) progressFunc("Downloaded", 100);
+                place(from);
+            });
+            return;
+        }
+        m_prefetched.erase(prefetched);
     }
-    wxZipInputStream zip(fis);
-    if (!zip.IsOk()) {
-        return Err("Unable to read zip");
+
+    if (this->joinInFlight(key, { errorFunc, progressFunc, finishFunc })) {
+        return;
     }
-    std::unique_ptr<wxZipEntry> entry;
-    while (entry.reset(zip.GetNextEntry()), entry) {
-        auto path = targetLocation / entry->GetName().ToStdWstring();
-        wxFileName fn;
+    Download::create(
+        url, target, m_downloadSegments,
+        [this, key](std::string const& error) -> void {
+            this->failInFlight(key, error);
+        },
+        [this, key](std::string const& text, int progress) -> void {
+            this->progressInFlight(key, text, progress);
+        },
+        [this, key](ghc::filesystem::path const& path) -> void {
+            this->finishInFlight(key, path);
+        },
+        sha256,
+        m_cancelToken
+    )->start();
+}
 
-        if (entry->IsDir()) {
-            fn.AssignDir(path.wstring());
-        } else {
-            fn.Assign(path.wstring());
+tl::optional<std::string> Manager::findArtifact(
+    std::string const& url,
+    std::string const& sha256,
+    std::chrono::seconds maxAge
+) const {
+    if (sha256.size()) {
+        if (m_artifactStore.has(sha256)) {
+            return sha256;
         }
+        return tl::nullopt;
+    }
+    return m_artifactStore.resolve(url, maxAge);
+}
 
-        if (!wxDirExists(fn.GetPath())) {
-            wxFileName::Mkdir(fn.GetPath(), entry->GetMode(), wxPATH_MKDIR_FULL);
+void Manager::fetchArtifact(
+    std::string const& url,
+    std::string const& sha256,
+    std::chrono::seconds maxAge,
+    ghc::filesystem::path const& target,
+    DownloadErrorFunc errorFunc,
+    DownloadProgressFunc progressFunc,
+    DownloadFileFinishFunc finishFunc,
+    bool allowHardlink
+) {
+    auto stored = this->findArtifact(url, sha256, maxAge);
+    if (stored) {
+        auto res = m_artifactStore.materialize(stored.value(), target, allowHardlink);
+        if (res) {
+            this->CallAfter([progressFunc, finishFunc, target]() -> void {
+                if (progressFunc) progressFunc("Downloaded", 100);
+                if (finishFunc) finishFunc(target);
+            });
+            return;
         }
+        // fall back to downloading it again
+    }
+    this->downloadFile(
+        url,
+        m_artifactStore.getStagingPath(url),
+        errorFunc,
+        progressFunc,
+        [this, url, sha256, maxAge, target, allowHardlink, errorFunc, finishFunc](
+            ghc::filesystem::path const& path
+        ) -> void {
+            std::string hash;
+            auto added = m_artifactStore.add(path, sha256, url);
+            std::error_code ec;
+            ghc::filesystem::remove(path.parent_path(), ec);
+            if (added) {
+                hash = added.value();
+                m_artifactStore.collectGarbage(hash);
+            } else {
+                // another caller sharing the same download 
+                // may have already moved it into the store
+                auto stored = this->findArtifact(url, sha256, maxAge);
+                if (!stored) {
+                    if (errorFunc) errorFunc(added.error());
+                    return;
+                }
+                hash = stored.value();
+            }
+            auto res = m_artifactStore.materialize(hash, target, allowHardlink);
+            if (!res) {
+                if (errorFunc) errorFunc(res.error());
+                return;
+            }
+            if (finishFunc) finishFunc(target);
+        },
+        sha256
+    );
+}
 
-        if (entry->IsDir()) continue;
+void Manager::prefetchFile(
+    std::string const& url,
+    ghc::filesystem::path const& target
+) {
+    if (m_prefetched.count(url)) {
+        return;
+    }
+    m_prefetched.insert({ url, target });
+    this->downloadFile(
+        url, target,
+        [this, url](std::string const&) -> void {
+            m_prefetched.erase(url);
+        },
+        nullptr,
+        nullptr
+    );
+}
 
-        if (!zip.CanRead()) {
-            return Err(
-                "Unable to read the zip entry \"" +
-                entry->GetName().ToStdString() + "\""
-            );
-        }
+Result<> Manager::extractArchiveTo(
+    ghc::filesystem::path const& archive,
+    ghc::filesystem::path const& targetLocation
+) {
+    ZipCrcCache crcCache(m_dataDirectory / CACHE_DIR / "extracted.json");
+    // flushed to disk before the CLI gets swapped in
+    auto res = extractArchive(
+        archive, targetLocation, &crcCache, true, &m_jobScheduler, m_cancelToken
+    );
+    crcCache.save();
+    return res;
+}
 
-        wxFileOutputStream out(path.wstring());
+void Manager::streamDownload(
+    std::string const& url,
+    DownloadDataFunc dataFunc,
+    DownloadErrorFunc errorFunc,
+    DownloadProgressFunc progressFunc,
+    CloneFinishFunc finishFunc
+) {
+    auto failed = std::make_shared<bool>(false);
+    auto fail = [failed, errorFunc](std::string const& msg) -> void {
+        if (*failed) return;
+        *failed = true;
+        if (errorFunc) errorFunc(msg);
+    };
+    auto request = this->createWebRequest(
+        url,
+        [failed, fail, finishFunc](wxWebRequestEvent& evt) -> void {
+            if (*failed) return;
+            switch (evt.GetState()) {
+                case wxWebRequest::State_Completed: {
+                    auto res = evt.GetResponse();
+                    if (!res.IsOk()) {
+                        return fail("Web request returned not OK");
+                    }
+                    if (res.GetStatus() != 200) {
+                        return fail("Web request returned " + std::to_string(res.GetStatus()));
+                    }
+                    if (finishFunc) finishFunc();
+                } break;
 
-        if (!out.IsOk()) {
-            return Err("Unable to create file \"" + path.string() + "\"");
-        }
+                case wxWebRequest::State_Unauthorized: {
+                    fail("Unauthorized to do web request");
+                } break;
+
+                case wxWebRequest::State_Failed: {
+                    fail("Web request failed");
+                } break;
 
-        zip.Read(out);
+                case wxWebRequest::State_Cancelled: {
+                    fail("Web request cancelled");
+                } break;
+
+                default: break;
+            }
+        },
+        [failed, fail, dataFunc, progressFunc](wxWebRequestEvent& evt) -> void {
+            // error pages are reported once the request completes
+            if (*failed || evt.GetResponse().GetStatus() != 200) return;
+            auto res = dataFunc(evt.GetDataBuffer(), evt.GetDataSize());
+            if (!res) {
+                fail(res.error());
+                auto request = evt.GetRequest();
+                request.Cancel();
+                return;
+            }
+            if (!progressFunc) return;
+            auto expected = evt.GetRequest().GetBytesExpectedToReceive();
+            if (expected <= 0) {
+                return progressFunc("Downloading", 0);
+            }
+            progressFunc(
+                "Downloading",
+                static_cast<int>(
+                    static_cast<double>(evt.GetRequest().GetBytesReceived()) /
+                    expected * 100.0
+                )
+            );
+        },
+        m_cancelToken
+    );
+    if (!request.IsOk()) {
+        return fail("Unable to create web request");
     }
-    return Ok();
+    request.SetStorage(wxWebRequest::Storage_None);
+    request.Start();
+}
+
+void Manager::findCLIAsset(
+    DownloadErrorFunc errorFunc,
+    DownloadProgressFunc progressFunc,
+    ReleaseAssetFunc finishFunc
+) {
+    this->fetchFile(
+        CLI_RELEASE_URL,
+        RELEASE_MAX_AGE,
+        errorFunc,
+        [errorFunc, progressFunc, finishFunc](ghc::filesystem::path const& body) -> void {
+            auto release = parseRelease(body);
+            if (!release) {
+                if (errorFunc) errorFunc(release.error());
+                return;
+            }
+            auto tagName = release.value().m_tagName;
+            if (progressFunc) progressFunc("Downloading version " + tagName, 0);
+
+            // releases may offer the same build in several 
+            // formats, the fastest to extract is preferred
+            auto asset = release.value().findAsset(
+                PLATFORM_ASSET_IDENTIFIER, getSupportedArchiveExtensions()
+            );
+            if (!asset) {
+                if (errorFunc) {
+                    errorFunc("No release asset for " PLATFORM_NAME " found");
+                }
+                return;
+            }
+            finishFunc(asset.value().m_name, asset.value().m_url, asset.value().m_sha256);
+        }
+    );
 }
 
 void Manager::downloadCLI(
     DownloadErrorFunc errorFunc,
     DownloadProgressFunc progressFunc,
-    DownloadFinishFunc finishFunc
+    DownloadFileFinishFunc finishFunc
 ) {
-    this->webRequest(
-        "https://api.github.com/repos/geode-sdk/cli/releases/latest",
-        false,
+    errorFunc = this->unlessCancelled(errorFunc);
+    progressFunc = this->unlessCancelled(progressFunc);
+    finishFunc = this->unlessCancelled(finishFunc);
+
+    this->findCLIAsset(
         errorFunc,
-        nullptr,
-        [this, errorFunc, progressFunc, finishFunc](wxWebResponse const& res) -> void {
+        progressFunc,
+        [this, errorFunc, progressFunc, finishFunc](
+            std::string const& name, std::string const& url, std::string const& sha256
+        ) -> void {
+            this->fetchArtifact(
+                url,
+                sha256,
+                RELEASE_ASSET_MAX_AGE,
+                m_dataDirectory / DOWNLOADS_DIR / name,
+                errorFunc,
+                progressFunc,
+                finishFunc
+            );
+        }
+    );
+}
+
+void Manager::streamInstallCLI(
+    DownloadErrorFunc errorFunc,
+    DownloadProgressFunc progressFunc,
+    CloneFinishFunc finishFunc
+) {
+    errorFunc = this->unlessCancelled(errorFunc);
+    progressFunc = this->unlessCancelled(progressFunc);
+    finishFunc = this->unlessCancelled(finishFunc);
+
+    this->findCLIAsset(
+        errorFunc,
+        progressFunc,
+        [this, errorFunc, progressFunc, finishFunc](
+            std::string const& name, std::string const& url, std::string const& sha256
+        ) -> void {
+            // installed from the store if it's been 
+            // downloaded before
+            if (this->findArtifact(url, sha256, RELEASE_ASSET_MAX_AGE)) {
+                auto archive = m_dataDirectory / DOWNLOADS_DIR / name;
+                return this->fetchArtifact(
+                    url, sha256, RELEASE_ASSET_MAX_AGE, archive,
+                    errorFunc, progressFunc,
+                    [this, errorFunc, finishFunc](ghc::filesystem::path const& archive) -> void {
+                        this->installCLI(
+                            archive,
+                            [archive, errorFunc](std::string const& error) -> void {
+                                std::error_code ec;
+                                ghc::filesystem::remove(archive, ec);
+                                if (errorFunc) errorFunc(error);
+                            },
+                            [archive, finishFunc]() -> void {
+                                std::error_code ec;
+                                ghc::filesystem::remove(archive, ec);
+                                if (finishFunc) finishFunc();
+                            }
+                        );
+                    }
+                );
+            }
+            auto staging = this->prepareBinStaging();
+            if (!staging) {
+                if (errorFunc) errorFunc(staging.error());
+                return;
+            }
+            auto stagingPath = staging.value();
+            auto created = ArchiveStreamExtractor::create(name, stagingPath, m_cancelToken);
+            if (!created) {
+                std::error_code ec;
+                ghc::filesystem::remove_all(stagingPath, ec);
+                if (errorFunc) errorFunc(created.error());
+                return;
+            }
+            auto extractor = created.value();
+            // the archive is hashed on its way into the 
+            // extractor and checked before the staged 
+            // files are swapped in
+            auto hasher = std::make_shared<Sha256>();
+            // and kept in the store for next time. Failing 
+            // to do that doesn't fail the install
+            auto storePath = m_artifactStore.getStagingPath(url);
+            auto store = std::make_shared<std::ofstream>();
             try {
-                auto json = nlohmann::json::parse(res.AsString());
-
-                auto tagName = json["tag_name"].get<std::string>();
-                if (progressFunc) progressFunc("Downloading version " + tagName, 0);
-
-                for (auto& asset : json["assets"]) {
-                    auto name = asset["name"].get<std::string>();
-                    if (name.find(PLATFORM_ASSET_IDENTIFIER) != std::string::npos) {
-                        return this->webRequest(
-                            asset["browser_download_url"].get<std::string>(),
-                            true,
-                            errorFunc,
-                            progressFunc,
-                            finishFunc
+                ghc::filesystem::create_directories(storePath.parent_path());
+                store->open(storePath, std::ios::binary | std::ios::trunc);
+            } catch(std::exception&) {}
+            // nothing will ever pick up a half-written 
+            // artifact or half-extracted staging files
+            auto fail = [storePath, store, stagingPath, errorFunc](std::string const& error) -> void {
+                store->close();
+                std::error_code ec;
+                ghc::filesystem::remove_all(storePath.parent_path(), ec);
+                ghc::filesystem::remove_all(stagingPath, ec);
+                if (errorFunc) errorFunc(error);
+            };
+            this->streamDownload(
+                url,
+                [extractor, hasher, store](void const* data, size_t size) -> Result<> {
+                    hasher->update(data, size);
+                    if (store->is_open()) {
+                        store->write(static_cast<char const*>(data), size);
+                    }
+                    return extractor->write(data, size);
+                },
+                fail,
+                progressFunc,
+                [
+                    this, url, storePath, store, extractor, hasher, sha256, fail, errorFunc, finishFunc
+                ]() -> void {
+                    auto res = extractor->finish();
+                    if (!res) {
+                        return fail(res.error());
+                    }
+                    auto digest = hasher->finish();
+                    store->close();
+                    std::error_code ec;
+                    if (sha256.size() && !digestsMatch(digest, sha256)) {
+                        return fail(
+                            "Checksum mismatch for the CLI: expected " +
+                            sha256 + ", got " + digest
                         );
                     }
+                    auto promoted = this->promoteBinStaging();
+                    if (!promoted) {
+                        // the staging directory may hold the only 
+                        // copy of the CLI if promoting failed halfway
+                        ghc::filesystem::remove_all(storePath.parent_path(), ec);
+                        if (errorFunc) errorFunc(promoted.error());
+                        return;
+                    }
+                    if (*store) {
+                        m_artifactStore.add(storePath, digest, url);
+                        m_artifactStore.collectGarbage(digest);
+                    }
+                    ghc::filesystem::remove_all(storePath.parent_path(), ec);
+                    if (finishFunc) finishFunc();
                 }
-                if (errorFunc) {
-                    errorFunc("No release asset for " PLATFORM_NAME " found");
-                }
+            );
+        }
+    );
+}
+
+static std::string getVersionsURL(DevBranch branch) {
+    return branch == DevBranch::Nightly ? 
+        "https://raw.githubusercontent.com/geode-sdk/suite/nightly/versions.json" : 
+        "https://raw.githubusercontent.com/geode-sdk/suite/main/versions.json";
+}
+
+void Manager::prefetchReleaseData() {
+    // only into the cache; whoever needs them 
+    // later reads them from there, so there's 
+    // no point in reading them into memory now
+    this->fetchFile(CLI_RELEASE_URL, RELEASE_MAX_AGE, nullptr, nullptr);
+    // the branch is only picked later in the flow, 
+    // and both files are tiny
+    for (auto branch : { DevBranch::Stable, DevBranch::Nightly }) {
+        this->fetchFile(getVersionsURL(branch), VERSIONS_MAX_AGE, nullptr, nullptr);
+    }
+}
+
+void Manager::fetchVersions(
+    DevBranch branch,
+    DownloadErrorFunc errorFunc,
+    VersionsFetchFunc finishFunc
+) {
+    this->fetch(
+        getVersionsURL(branch),
+        VERSIONS_MAX_AGE,
+        errorFunc,
+        [errorFunc, finishFunc](std::string const& body) -> void {
+            nlohmann::json json;
+            try {
+                json = nlohmann::json::parse(body);
             } catch(std::exception& e) {
                 if (errorFunc) {
                     errorFunc("Unable to parse JSON: " + std::string(e.what()));
                 }
+                return;
             }
+            finishFunc(json);
         }
     );
 }
@@ -248,24 +906,17 @@ void Manager::checkForUpdates(
     DownloadErrorFunc errorFunc,
     UpdateCheckFinishFunc finishFunc
 ) {
+    errorFunc = this->unlessCancelled(errorFunc);
+    finishFunc = this->unlessCancelled(finishFunc);
 
-    std::string url = "https://raw.githubusercontent.com/geode-sdk/suite/main/versions.json";
-
-    if (installation.m_branch == DevBranch::Nightly) {
-        url = "https://raw.githubusercontent.com/geode-sdk/suite/nightly/versions.json";
-    }
-
-    this->webRequest(
-        url,
-        false,
+    this->fetchVersions(
+        installation.m_branch,
         errorFunc,
-        nullptr,
-        [this, errorFunc, finishFunc, installation](
-            wxWebResponse const& res
+        [errorFunc, finishFunc, installation](
+            nlohmann::json const& json
         ) -> void {
             try {
-                auto json = nlohmann::json::parse(res.AsString());
-                auto availableVersion = VersionInfo(json["loader"].get<std::string>());
+                auto availableVersion = VersionInfo(json.at("loader").get<std::string>());
                 finishFunc(installation.m_loaderVersion, availableVersion);
             } catch(std::exception& e) {
                 if (errorFunc) {
@@ -280,19 +931,17 @@ void Manager::checkCLIForUpdates(
     DownloadErrorFunc errorFunc,
     UpdateCheckFinishFunc finishFunc
 ) {
-    std::string url = "https://raw.githubusercontent.com/geode-sdk/suite/main/versions.json";
+    errorFunc = this->unlessCancelled(errorFunc);
+    finishFunc = this->unlessCancelled(finishFunc);
 
-    this->webRequest(
-        url,
-        false,
+    this->fetchVersions(
+        DevBranch::Stable,
         errorFunc,
-        nullptr,
         [this, errorFunc, finishFunc](
-            wxWebResponse const& res
+            nlohmann::json const& json
         ) -> void {
             try {
-                auto json = nlohmann::json::parse(res.AsString());
-                auto availableVersion = VersionInfo(json["cli"].get<std::string>());
+                auto availableVersion = VersionInfo(json.at("cli").get<std::string>());
                 finishFunc(this->m_CLIVersion, availableVersion);
             } catch(std::exception& e) {
                 if (errorFunc) {
@@ -303,6 +952,88 @@ void Manager::checkCLIForUpdates(
     );
 }
 
+void Manager::checkAllForUpdates(
+    UpdateCheckAllFinishFunc finishFunc
+) {
+    finishFunc = this->unlessCancelled(finishFunc);
+
+    struct Batch {
+        UpdateCheckTable m_table;
+        std::vector<DevBranch> m_branches;
+        size_t m_pending = 0;
+    };
+    auto batch = std::make_shared<Batch>();
+
+    batch->m_table.m_cli.m_current = m_CLIVersion;
+    for (auto& inst : m_installations) {
+        UpdateCheckResult result;
+        result.m_current = inst.m_loaderVersion;
+        batch->m_table.m_installations.push_back(result);
+        batch->m_branches.push_back(inst.m_branch);
+    }
+
+    // the CLI version is listed in the stable 
+    // versions.json, so that one is needed 
+    // whenever the suite is installed. Checked once, 
+    // so both uses agree on whether it is
+    auto checkCLI = this->isSuiteInstalled();
+    std::set<DevBranch> branches;
+    if (checkCLI) {
+        branches.insert(DevBranch::Stable);
+    }
+    branches.insert(batch->m_branches.begin(), batch->m_branches.end());
+
+    if (branches.empty()) {
+        this->CallAfter([batch, finishFunc]() -> void {
+            finishFunc(batch->m_table);
+        });
+        return;
+    }
+
+    batch->m_pending = branches.size();
+    for (auto branch : branches) {
+        auto done = [batch, finishFunc]() -> void {
+            if (!--batch->m_pending) {
+                finishFunc(batch->m_table);
+            }
+        };
+        this->fetchVersions(
+            branch,
+            [batch, branch, checkCLI, done](std::string const& error) -> void {
+                if (checkCLI && branch == DevBranch::Stable) {
+                    batch->m_table.m_cli.m_error = error;
+                }
+                for (size_t i = 0; i < batch->m_branches.size(); i++) {
+                    if (batch->m_branches[i] == branch) {
+                        batch->m_table.m_installations[i].m_error = error;
+                    }
+                }
+                done();
+            },
+            [batch, branch, checkCLI, done](nlohmann::json const& json) -> void {
+                auto read = [&json](
+                    const char* key, UpdateCheckResult& result
+                ) -> void {
+                    try {
+                        result.m_available = VersionInfo(json.at(key).get<std::string>());
+                    } catch(std::exception& e) {
+                        result.m_error = "Unable to parse JSON: " + std::string(e.what());
+                    }
+                };
+                if (checkCLI && branch == DevBranch::Stable) {
+                    read("cli", batch->m_table.m_cli);
+                }
+                for (size_t i = 0; i < batch->m_branches.size(); i++) {
+                    if (batch->m_branches[i] == branch) {
+                        read("loader", batch->m_table.m_installations[i]);
+                    }
+                }
+                done();
+            }
+        );
+    }
+}
+
 
 ghc::filesystem::path const& Manager::getDataDirectory() const {
     return m_dataDirectory;
@@ -359,11 +1090,41 @@ bool Manager::isFirstTime() const {
     return !m_dataLoaded;
 }
 
+size_t Manager::getDownloadSegments() const {
+    return m_downloadSegments;
+}
+
+void Manager::setDownloadSegments(size_t segments) {
+    m_downloadSegments = std::max<size_t>(segments, 1);
+}
+
+bool Manager::getShareInstallFiles() const {
+    return m_shareInstallFiles;
+}
+
+void Manager::setShareInstallFiles(bool share) {
+    m_shareInstallFiles = share;
+}
+
+uint64_t Manager::getArtifactStoreBudget() const {
+    return m_artifactStore.getBudget();
+}
+
+void Manager::setArtifactStoreBudget(uint64_t budget) {
+    m_artifactStore.setBudget(budget);
+    m_artifactStore.collectGarbage();
+}
+
 
 Result<> Manager::loadData() {
     m_suiteDirectory = this->getDefaultSuiteDirectory();
     m_dataDirectory = this->getDefaultDataDirectory();
     m_binDirectory = this->getDefaultBinDirectory();
+    m_httpCache.setDirectory(m_dataDirectory / CACHE_DIR);
+    m_artifactStore.setDirectory(m_dataDirectory / STORE_DIR);
+    // left behind by replacing files that were in 
+    // use last time, like the utils library
+    removeAsideFiles(m_dataDirectory, true);
 
     auto configFile = m_dataDirectory / INSTALL_DATA_JSON;
 
@@ -401,6 +1162,14 @@ Result<> Manager::loadData() {
             );
 
             this->addInstallation(inst);
+
+            std::set<ghc::filesystem::path> dirs;
+            for (auto& file : this->getSharedLoaderFiles(inst.m_path)) {
+                dirs.insert(file.parent_path());
+            }
+            for (auto& dir : dirs) {
+                removeAsideFiles(dir, false);
+            }
         }
 
         if (json.contains("default-installation")) {
@@ -411,6 +1180,18 @@ Result<> Manager::loadData() {
             m_CLIVersion = VersionInfo(json["cli-version"].get<std::string>());
         }
 
+        if (json.contains("download-segments")) {
+            this->setDownloadSegments(json["download-segments"].get<size_t>());
+        }
+
+        if (json.contains("share-install-files")) {
+            this->setShareInstallFiles(json["share-install-files"].get<bool>());
+        }
+
+        if (json.contains("artifact-store-budget")) {
+            this->setArtifactStoreBudget(json["artifact-store-budget"].get<uint64_t>());
+        }
+
     } catch(std::exception& e) {
         return Err("Unable to parse " INSTALL_DATA_JSON ": " + std::string(e.what()));
     }
@@ -430,6 +1211,9 @@ Result<> Manager::saveData() {
     }
 
     m_loadedConfigJson["cli-version"] = m_CLIVersion.toString();
+    m_loadedConfigJson["download-segments"] = m_downloadSegments;
+    m_loadedConfigJson["artifact-store-budget"] = m_artifactStore.getBudget();
+    m_loadedConfigJson["share-install-files"] = m_shareInstallFiles;
 
     m_loadedConfigJson["installations"] = nlohmann::json::array();
     for (auto x : m_installations) {
@@ -458,21 +1242,184 @@ Result<> Manager::deleteData() {
     return Ok();
 }
 
+JobScheduler& Manager::getJobScheduler() {
+    return m_jobScheduler;
+}
+
+void Manager::shutdown() {
+    m_cancelToken->cancel();
+    m_jobScheduler.shutdown();
+}
+
 void Manager::setCLIVersion(VersionInfo const& v) {
     m_CLIVersion = v;
 }
 
+VersionInfo Manager::getCLIVersion() const {
+    return m_CLIVersion;
+}
+
+static ghc::filesystem::path withSuffix(ghc::filesystem::path path, const char* suffix) {
+    path += suffix;
+    return path;
+}
+
+Result<ghc::filesystem::path> Manager::prepareBinStaging() {
+    auto staging = withSuffix(m_binDirectory, STAGING_SUFFIX);
+    try {
+        ghc::filesystem::remove_all(staging);
+        ghc::filesystem::create_directories(staging);
+        if (ghc::filesystem::exists(m_binDirectory)) {
+            // seed the staging directory with links to the 
+            // current files, so files the update doesn't 
+            // touch carry over without being copied
+            for (auto& file : ghc::filesystem::recursive_directory_iterator(m_binDirectory)) {
+                auto to = staging / ghc::filesystem::relative(file.path(), m_binDirectory);
+                if (file.is_directory()) {
+                    ghc::filesystem::create_directories(to);
+                    continue;
+                }
+                std::error_code ec;
+                ghc::filesystem::create_hard_link(file.path(), to, ec);
+                if (ec) {
+                    ghc::filesystem::copy_file(file.path(), to);
+                }
+            }
+        }
+    } catch(std::exception& e) {
+        return Err("Unable to prepare staging directory: " + std::string(e.what()));
+    }
+    return Ok(staging);
+}
+
+Result<> Manager::promoteBinStaging() {
+    auto staging = withSuffix(m_binDirectory, STAGING_SUFFIX);
+    auto previous = withSuffix(m_binDirectory, PREVIOUS_SUFFIX);
+    auto previousVersion = withSuffix(m_binDirectory, PREVIOUS_VERSION_SUFFIX);
+    std::error_code ec;
+    ghc::filesystem::remove_all(previous, ec);
+    ghc::filesystem::remove(previousVersion, ec);
+    ec.clear();
+
+    if (ghc::filesystem::exists(m_binDirectory)) {
+        ghc::filesystem::rename(m_binDirectory, previous, ec);
+    }
+    if (!ec) {
+        ghc::filesystem::rename(staging, m_binDirectory, ec);
+        if (!ec) {
+            // the new version is only set once this 
+            // returns, so this is still the old one
+            if (ghc::filesystem::exists(previous)) {
+                std::ofstream ofs(previousVersion);
+                ofs << m_CLIVersion.toString();
+            }
+            return Ok();
+        }
+        std::error_code restoreEc;
+        ghc::filesystem::rename(previous, m_binDirectory, restoreEc);
+        if (restoreEc) {
+            return Err("Unable to restore the previous CLI: " + restoreEc.message());
+        }
+    }
+
+    // Windows won't rename a directory with a file in 
+    // use (like a loaded utils lib), so fall back to 
+    // moving the files over one by one. This can't be 
+    // rolled back, but at least every file is replaced 
+    // atomically
+    try {
+        for (auto& file : ghc::filesystem::recursive_directory_iterator(staging)) {
+            auto to = m_binDirectory / ghc::filesystem::relative(file.path(), staging);
+            if (file.is_directory()) {
+                ghc::filesystem::create_directories(to);
+                continue;
+            }
+            auto res = placeFile(file.path(), to);
+            if (!res) {
+                return Err("Unable to install \"" + to.string() + "\": " + res.error());
+            }
+        }
+    } catch(std::exception& e) {
+        return Err("Unable to install the CLI: " + std::string(e.what()));
+    }
+    ghc::filesystem::remove_all(staging, ec);
+    return Ok();
+}
+
+bool Manager::canRollbackCLI() const {
+    return
+        ghc::filesystem::exists(withSuffix(m_binDirectory, PREVIOUS_SUFFIX)) &&
+        ghc::filesystem::exists(withSuffix(m_binDirectory, PREVIOUS_VERSION_SUFFIX));
+}
+
+Result<> Manager::rollbackCLI() {
+    auto previous = withSuffix(m_binDirectory, PREVIOUS_SUFFIX);
+    auto previousVersion = withSuffix(m_binDirectory, PREVIOUS_VERSION_SUFFIX);
+    auto discarded = withSuffix(m_binDirectory, STAGING_SUFFIX);
+    if (!this->canRollbackCLI()) {
+        return Err("There is no previous version of the CLI to go back to");
+    }
+    std::string version;
+    {
+        std::ifstream ifs(previousVersion);
+        std::getline(ifs, version);
+    }
+    std::error_code ec;
+    ghc::filesystem::remove_all(discarded, ec);
+    ghc::filesystem::rename(m_binDirectory, discarded, ec);
+    if (ec) {
+        return Err("Unable to move the current CLI out of the way: " + ec.message());
+    }
+    ghc::filesystem::rename(previous, m_binDirectory, ec);
+    if (ec) {
+        std::error_code restoreEc;
+        ghc::filesystem::rename(discarded, m_binDirectory, restoreEc);
+        return Err("Unable to restore the previous CLI: " + ec.message());
+    }
+    ghc::filesystem::remove_all(discarded, ec);
+    ghc::filesystem::remove(previousVersion, ec);
+    m_CLIVersion = VersionInfo(version);
+    return this->saveData();
+}
+
 Result<> Manager::installCLI(
-    ghc::filesystem::path const& cliZipPath
+    ghc::filesystem::path const& cliArchivePath
 ) {
-    auto targetDir = m_binDirectory;
-    if (
-        !ghc::filesystem::exists(targetDir) &&
-        !ghc::filesystem::create_directories(targetDir)
-    ) {
-        return Err("Unable to create directory " + targetDir.string());
+    auto staging = this->prepareBinStaging();
+    if (!staging) {
+        return Err(staging.error());
+    }
+    auto res = this->extractArchiveTo(cliArchivePath, staging.value());
+    if (!res) {
+        std::error_code ec;
+        ghc::filesystem::remove_all(staging.value(), ec);
+        return res;
+    }
+    return this->promoteBinStaging();
+}
+
+void Manager::installCLI(
+    ghc::filesystem::path const& cliArchivePath,
+    DownloadErrorFunc errorFunc,
+    CloneFinishFunc finishFunc
+) {
+    auto submitted = m_jobScheduler.submit([this, cliArchivePath, errorFunc, finishFunc]() -> void {
+        auto res = this->installCLI(cliArchivePath);
+        wxQueueEvent(this, new CallOnMainEvent(
+            [res, errorFunc, finishFunc]() -> void {
+                if (!res) {
+                    if (errorFunc) errorFunc(res.error());
+                    return;
+                }
+                if (finishFunc) finishFunc();
+            },
+            CALL_ON_MAIN,
+            wxID_ANY
+        ));
+    }, JobPriority::Bulk);
+    if (!submitted && errorFunc) {
+        errorFunc("The installer is shutting down");
     }
-    return this->unzipTo(cliZipPath, targetDir);
 }
 
 Result<> Manager::addCLIToPath() {
@@ -507,20 +1454,16 @@ Result<> Manager::addCLIToPath() {
 }
 
 bool Manager::isGeodeUtilsInstalled() const {
-    #ifdef _WIN32
-    return ghc::filesystem::exists(m_binDirectory / "geodeutils.dll");
-    #else
-    return ghc::filesystem::exists(m_binDirectory / "libgeodeutils.dylib");
-    #endif
+    return ghc::filesystem::exists(m_binDirectory / UTILS_LIB_NAME);
 }
 
 void* Manager::loadFunctionFromUtilsLib(const char* name) {
     #if _WIN32
-    auto lib = LoadLibraryW((m_binDirectory / "geodeutils.dll").wstring().c_str());
+    auto lib = LoadLibraryW((m_binDirectory / UTILS_LIB_NAME).wstring().c_str());
     if (!lib) return nullptr;
     return GetProcAddress(lib, name);
     #else
-    auto lib = dlopen((m_binDirectory / "libgeodeutils.dylib").string().c_str(), RTLD_LAZY);
+    auto lib = dlopen((m_binDirectory / UTILS_LIB_NAME).string().c_str(), RTLD_LAZY);
     if (!lib) return nullptr;
     return dlsym(lib, name);
     #endif
@@ -532,16 +1475,22 @@ Result<> Manager::installSuite(
     DownloadProgressFunc progressFunc,
     CloneFinishFunc finishFunc
 ) {
+    errorFunc = this->unlessCancelled(errorFunc);
+    progressFunc = this->unlessCancelled(progressFunc);
+    finishFunc = this->unlessCancelled(finishFunc);
+
     if (!this->isGeodeUtilsInstalled()) {
         return Err("Geode CLI seems to not have been installed");
     }
 
-    this->Bind(CALL_ON_MAIN, &Manager::onSyncThreadCall, this);
+    auto progress = std::make_shared<ProgressSlot>();
+    this->watchProgress(progress, progressFunc);
 
-    std::thread t([this, branch, errorFunc, progressFunc, finishFunc]() -> void {
-        auto throwError = [errorFunc, this](std::string const& msg) -> void {
+    auto submitted = m_jobScheduler.submit([this, branch, progress, errorFunc, finishFunc]() -> void {
+        auto throwError = [errorFunc, progress, this](std::string const& msg) -> void {
             wxQueueEvent(this, new CallOnMainEvent(
-                [errorFunc, msg]() -> void {
+                [this, errorFunc, progress, msg]() -> void {
+                    this->unwatchProgress(progress);
                     if (errorFunc) errorFunc(msg);
                 },
                 CALL_ON_MAIN,
@@ -549,8 +1498,20 @@ Result<> Manager::installSuite(
             ));
         };
 
+        // the library can't be interrupted once it's 
+        // running, so this is the last chance to stop
+        if (m_cancelToken->isCancelled()) {
+            return;
+        }
+
+        auto installSuiteV2 = utilsFunc<cli::geode_install_suite_v2>("geode_install_suite_v2");
         auto installSuite = utilsFunc<cli::geode_install_suite>("geode_install_suite");
 
+        if (!installSuiteV2 && !installSuite) {
+            throwError("Fatal: Unable to fetch install function.");
+            return;
+        }
+
         if (
             !ghc::filesystem::exists(m_suiteDirectory) &&
             !ghc::filesystem::create_directories(m_suiteDirectory)
@@ -559,33 +1520,39 @@ Result<> Manager::installSuite(
             return;
         }
 
-        static DownloadProgressFunc progFunc;
-        progFunc = progressFunc;
-
-        auto res = installSuite(
-            m_suiteDirectory.string().c_str(),
-            branch == DevBranch::Nightly,
-            [](const char* status, int per) -> void {
-                // limit window update rate
-                static auto time = std::chrono::high_resolution_clock::now();
-                auto now = std::chrono::high_resolution_clock::now();
-                if (std::chrono::duration_cast<std::chrono::milliseconds>(now - time).count() > 300) {
-                    wxQueueEvent(Manager::get(), new CallOnMainEvent(
-                        [status, per]() -> void {
-                            if (progFunc) progFunc(status, per);
-                        },
-                        CALL_ON_MAIN,
-                        wxID_ANY
-                    ));
-                    time = now;
+        const char* res;
+        if (installSuiteV2) {
+            res = installSuiteV2(
+                m_suiteDirectory.string().c_str(),
+                branch == DevBranch::Nightly,
+                [](const char* status, int per, void* slot) -> void {
+                    static_cast<ProgressSlot*>(slot)->set(status, per);
+                },
+                progress.get()
+            );
+        } else {
+            // the callback can only find the slot through 
+            // a static, so only one install at a time
+            static std::mutex legacyLock;
+            std::lock_guard<std::mutex> lock(legacyLock);
+
+            static ProgressSlot* progressSlot;
+            progressSlot = progress.get();
+
+            res = installSuite(
+                m_suiteDirectory.string().c_str(),
+                branch == DevBranch::Nightly,
+                [](const char* status, int per) -> void {
+                    progressSlot->set(status, per);
                 }
-            }
-        );
+            );
+        }
         if (res) {
             throwError(res);
         } else {
             wxQueueEvent(Manager::get(), new CallOnMainEvent(
-                [this, finishFunc]() -> void {
+                [this, progress, finishFunc]() -> void {
+                    this->unwatchProgress(progress);
                     m_suiteInstalled = true;
                     this->addSuiteEnv();
                     if (finishFunc) finishFunc();
@@ -594,8 +1561,11 @@ Result<> Manager::installSuite(
                 wxID_ANY
             ));
         }
-    });
-    t.detach();
+    }, JobPriority::Bulk);
+    if (!submitted) {
+        this->unwatchProgress(progress);
+        return Err("The installer is shutting down");
+    }
     return Ok();
 }
 
@@ -641,6 +1611,31 @@ Result<> Manager::uninstallSuite() {
 }
 
 
+static std::string getUtilsLibURL(DevBranch branch) {
+    #ifdef _WIN32
+    return branch == DevBranch::Nightly ? 
+        "https://github.com/geode-sdk/suite/raw/nightly/windows/geodeutils.dll" : 
+        "https://github.com/geode-sdk/suite/raw/main/windows/geodeutils.dll";
+    #elif defined(__APPLE__)
+    return branch == DevBranch::Nightly ? 
+        "https://github.com/geode-sdk/suite/raw/nightly/macos/libgeodeutils.dylib" :
+        "https://github.com/geode-sdk/suite/raw/main/macos/libgeodeutils.dylib";
+    #else
+        #error "Define download URL for geodeutils"
+    #endif
+}
+
+void Manager::prefetchGeodeUtilsLib(DevBranch branch) {
+    if (this->isGeodeUtilsInstalled()) {
+        return;
+    }
+    auto url = getUtilsLibURL(branch);
+    if (this->findArtifact(url, "", UTILS_LIB_MAX_AGE)) {
+        return;
+    }
+    this->prefetchFile(url, m_artifactStore.getStagingPath(url));
+}
+
 void Manager::installGeodeUtilsLib(
     bool update,
     DevBranch branch,
@@ -648,45 +1643,105 @@ void Manager::installGeodeUtilsLib(
     DownloadProgressFunc progressFunc,
     CloneFinishFunc finishFunc
 ) {
+    errorFunc = this->unlessCancelled(errorFunc);
+    progressFunc = this->unlessCancelled(progressFunc);
+    finishFunc = this->unlessCancelled(finishFunc);
+
     if (!update && this->isGeodeUtilsInstalled()) {
         return finishFunc();
     }
-    this->webRequest(
-    #ifdef _WIN32
-    branch == DevBranch::Nightly ? 
-        "https://github.com/geode-sdk/suite/raw/nightly/windows/geodeutils.dll" : 
-        "https://github.com/geode-sdk/suite/raw/main/windows/geodeutils.dll",
-    #elif defined(__APPLE__)
-    branch == DevBranch::Nightly ? 
-        "https://github.com/geode-sdk/suite/raw/nightly/macos/libgeodeutils.dylib" :
-        "https://github.com/geode-sdk/suite/raw/main/macos/libgeodeutils.dylib",
-    #else
-        #error "Define download URL for geodeutils"
-    #endif
-        true,
+    try {
+        if (
+            !ghc::filesystem::exists(m_binDirectory) &&
+            !ghc::filesystem::create_directories(m_binDirectory)
+        ) {
+            return errorFunc("Unable to create directory at " + m_binDirectory.string());
+        }
+    } catch(std::exception& e) {
+        return errorFunc(e.what());
+    }
+    // the library is only ever replaced (by placeFile), 
+    // never written to, so it can be a hardlink to the 
+    // stored copy instead of a second one
+    this->fetchArtifact(
+        getUtilsLibURL(branch),
+        "",
+        UTILS_LIB_MAX_AGE,
+        m_binDirectory / UTILS_LIB_NAME,
         errorFunc,
         progressFunc,
-        [this, errorFunc, finishFunc](wxWebResponse const& res) -> void {
-            try {
-                if (
-                    !ghc::filesystem::exists(m_binDirectory) &&
-                    !ghc::filesystem::create_directories(m_binDirectory)
-                ) {
-                    return errorFunc("Unable to create directory at " + m_binDirectory.string());
-                }
-                if (!ghc::filesystem::copy_file(
-                    res.GetDataFile().ToStdWstring(),
-                    m_binDirectory / res.GetSuggestedFileName().ToStdWstring(),
-                    ghc::filesystem::copy_options::overwrite_existing
-                )) {
-                    return errorFunc("Unable to copy geodeutils dll!");
-                }
-                finishFunc();
-            } catch(std::exception& e) {
-                return errorFunc(e.what());
+        [finishFunc](ghc::filesystem::path const&) -> void {
+            finishFunc();
+        },
+        true
+    );
+}
+
+std::vector<ghc::filesystem::path> Manager::getSharedLoaderFiles(
+    ghc::filesystem::path const& installPath
+) const {
+    std::vector<ghc::filesystem::path> files;
+    #ifdef _WIN32
+    std::error_code ec;
+    for (auto name : { "Geode.dll", "XInput9_1_0.dll" }) {
+        if (ghc::filesystem::is_regular_file(installPath / name, ec)) {
+            files.push_back(installPath / name);
+        }
+    }
+    // mods and their data live elsewhere in geode/ 
+    // and are left alone
+    auto resources = installPath / "geode" / "resources";
+    if (ghc::filesystem::is_directory(resources, ec)) {
+        for (
+            auto it = ghc::filesystem::recursive_directory_iterator(resources, ec);
+            it != ghc::filesystem::recursive_directory_iterator();
+            it.increment(ec)
+        ) {
+            if (ec) break;
+            if (it->is_regular_file(ec)) {
+                files.push_back(it->path());
             }
         }
-    );
+    }
+    #else
+    // the layout of a macOS install isn't tracked 
+    // yet (see uninstallGeodeFrom), so nothing is 
+    // shared there
+    #endif
+    return files;
+}
+
+void Manager::shareLoaderFiles(ghc::filesystem::path const& installPath) {
+    auto files = this->getSharedLoaderFiles(installPath);
+    // without reflinks, adopting the files would 
+    // only add another full copy of each
+    if (files.empty() || !m_artifactStore.canReflinkTo(installPath)) {
+        return;
+    }
+    for (auto& file : files) {
+        // the files are fine unshared too
+        if (m_cancelToken->isCancelled()) break;
+        auto hash = m_artifactStore.adopt(file);
+        if (!hash) continue;
+        // reflinks only; Geode's updater and resource 
+        // unpacking write these files in place, which 
+        // through a hardlink would change every 
+        // installation and the stored copy with it
+        auto shared = m_artifactStore.materialize(hash.value(), file);
+        // cloning failed after all (a volume can 
+        // refuse some files), so the rest would 
+        // only get copied over themselves
+        if (shared && shared.value() == LinkMode::Copy) break;
+    }
+    m_artifactStore.collectGarbage();
+}
+
+static ghc::filesystem::path getInstallPath(ghc::filesystem::path const& gdExePath) {
+    #if _WIN32
+    return gdExePath.parent_path();
+    #else
+    return gdExePath / "Contents";
+    #endif
 }
 
 Result<> Manager::installGeodeFor(
@@ -696,16 +1751,26 @@ Result<> Manager::installGeodeFor(
     DownloadProgressFunc progressFunc,
     CloneFinishFunc finishFunc
 ) {
+    errorFunc = this->unlessCancelled(errorFunc);
+    progressFunc = this->unlessCancelled(progressFunc);
+    finishFunc = this->unlessCancelled(finishFunc);
+
     if (!this->isGeodeUtilsInstalled()) {
         return Err("Geode Utility Library seems to not have been installed");
     }
 
-    this->Bind(CALL_ON_MAIN, &Manager::onSyncThreadCall, this);
+    auto installPath = getInstallPath(gdExePath);
+    auto share = m_shareInstallFiles;
+    auto progress = std::make_shared<ProgressSlot>();
+    this->watchProgress(progress, progressFunc);
 
-    std::thread t([this, gdExePath, branch, errorFunc, progressFunc, finishFunc]() -> void {
-        auto throwError = [errorFunc, this](std::string const& msg) -> void {
+    auto submitted = m_jobScheduler.submit([
+        this, gdExePath, installPath, share, branch, progress, errorFunc, finishFunc
+    ]() -> void {
+        auto throwError = [errorFunc, progress, this](std::string const& msg) -> void {
             wxQueueEvent(this, new CallOnMainEvent(
-                [errorFunc, msg]() -> void {
+                [this, errorFunc, progress, msg]() -> void {
+                    this->unwatchProgress(progress);
                     if (errorFunc) errorFunc(msg);
                 },
                 CALL_ON_MAIN,
@@ -713,9 +1778,10 @@ Result<> Manager::installGeodeFor(
             ));
         };
 
+        auto installGeodeV2 = utilsFunc<cli::geode_install_geode_v2>("geode_install_geode_v2");
         auto installGeode = utilsFunc<cli::geode_install_geode>("geode_install_geode");
 
-        if (!installGeode) {
+        if (!installGeodeV2 && !installGeode) {
             #if _WIN32
             throwError("Fatal: Unable to fetch install function.");
             #else
@@ -725,35 +1791,51 @@ Result<> Manager::installGeodeFor(
             return;
         }
 
-        static DownloadProgressFunc progFunc;
-        progFunc = progressFunc;
+        if (m_cancelToken->isCancelled()) {
+            return;
+        }
 
-        auto res = installGeode(
-            gdExePath.string().c_str(),
-            branch == DevBranch::Nightly,
-            true,
-            [](const char* status, int per) -> void {
-                wxQueueEvent(Manager::get(), new CallOnMainEvent(
-                    [status, per]() -> void {
-                        if (progFunc) progFunc(status, per);
-                    },
-                    CALL_ON_MAIN,
-                    wxID_ANY
-                ));
-            }
-        );
+        const char* res;
+        if (installGeodeV2) {
+            res = installGeodeV2(
+                gdExePath.string().c_str(),
+                branch == DevBranch::Nightly,
+                true,
+                [](const char* status, int per, void* slot) -> void {
+                    static_cast<ProgressSlot*>(slot)->set(status, per);
+                },
+                progress.get()
+            );
+        } else {
+            // the callback can only find the slot through 
+            // a static, so only one install at a time
+            static std::mutex legacyLock;
+            std::lock_guard<std::mutex> lock(legacyLock);
+
+            static ProgressSlot* progressSlot;
+            progressSlot = progress.get();
+
+            res = installGeode(
+                gdExePath.string().c_str(),
+                branch == DevBranch::Nightly,
+                true,
+                [](const char* status, int per) -> void {
+                    progressSlot->set(status, per);
+                }
+            );
+        }
         if (res) {
             throwError(res);
         } else {
+            if (share) {
+                this->shareLoaderFiles(installPath);
+            }
             wxQueueEvent(Manager::get(), new CallOnMainEvent(
-                [this, branch, gdExePath, finishFunc]() -> void {
+                [this, branch, gdExePath, installPath, progress, finishFunc]() -> void {
+                    this->unwatchProgress(progress);
                     Installation inst;
                     inst.m_exe = gdExePath.filename().wstring();
-                    #if _WIN32
-                    inst.m_path = gdExePath.parent_path();
-                    #else
-                    inst.m_path = gdExePath / "Contents";
-                    #endif
+                    inst.m_path = installPath;
                     if (!m_installations.size()) {
                         m_defaultInstallation = 0;
                     }
@@ -766,23 +1848,147 @@ Result<> Manager::installGeodeFor(
                 wxID_ANY
             ));
         }
-    });
-    t.detach();
+    }, JobPriority::Bulk);
+    if (!submitted) {
+        this->unwatchProgress(progress);
+        return Err("The installer is shutting down");
+    }
     return Ok();
 }
 
+struct Manager::BatchInstall {
+    DevBranch m_branch;
+    size_t m_parallelism;
+    std::vector<BatchInstallResult> m_results;
+    // indices of the targets to install into
+    std::vector<size_t> m_targets;
+    size_t m_next = 0;
+    size_t m_running = 0;
+    bool m_finished = false;
+    BatchInstallProgressFunc m_progressFunc;
+    BatchInstallFinishFunc m_finishFunc;
+};
+
+void Manager::continueBatchInstall(std::shared_ptr<BatchInstall> batch) {
+    while (batch->m_running < batch->m_parallelism && batch->m_next < batch->m_targets.size()) {
+        auto index = batch->m_targets.at(batch->m_next++);
+        batch->m_running++;
+        auto res = this->installGeodeFor(
+            batch->m_results.at(index).m_gdExePath,
+            batch->m_branch,
+            [this, batch, index](std::string const& error) -> void {
+                batch->m_results.at(index).m_error = error.size() ? error : "Unknown error";
+                batch->m_running--;
+                this->continueBatchInstall(batch);
+            },
+            [batch, index](std::string const& text, int progress) -> void {
+                if (batch->m_progressFunc) batch->m_progressFunc(index, text, progress);
+            },
+            [this, batch]() -> void {
+                batch->m_running--;
+                this->continueBatchInstall(batch);
+            }
+        );
+        if (!res) {
+            batch->m_results.at(index).m_error = res.error();
+            batch->m_running--;
+        }
+    }
+    if (batch->m_running || batch->m_next < batch->m_targets.size() || batch->m_finished) {
+        return;
+    }
+    batch->m_finished = true;
+    auto saved = this->saveData();
+    if (!saved) {
+        for (auto& result : batch->m_results) {
+            if (result.isOk()) {
+                result.m_error = "Installed, but unable to save installations: " + saved.error();
+            }
+        }
+    }
+    if (batch->m_finishFunc) batch->m_finishFunc(batch->m_results);
+}
+
+void Manager::installGeodeForAll(
+    std::vector<ghc::filesystem::path> const& gdExePaths,
+    DevBranch branch,
+    size_t parallelism,
+    BatchInstallProgressFunc progressFunc,
+    BatchInstallFinishFunc finishFunc
+) {
+    progressFunc = this->unlessCancelled(progressFunc);
+    finishFunc = this->unlessCancelled(finishFunc);
+
+    auto batch = std::make_shared<BatchInstall>();
+    batch->m_branch = branch;
+    // one worker is always left for everything else, 
+    // like extracting the CLI or hashing a download
+    auto maxParallelism = std::max<size_t>(m_jobScheduler.getThreadCount() - 1, 1);
+    batch->m_parallelism = parallelism ?
+        std::min(parallelism, maxParallelism) :
+        maxParallelism;
+    batch->m_progressFunc = progressFunc;
+    batch->m_finishFunc = finishFunc;
+
+    std::set<ghc::filesystem::path> installPaths;
+    for (size_t i = 0; i < gdExePaths.size(); i++) {
+        BatchInstallResult result;
+        result.m_gdExePath = gdExePaths.at(i);
+        if (installPaths.insert(getInstallPath(gdExePaths.at(i)).lexically_normal()).second) {
+            batch->m_targets.push_back(i);
+        } else {
+            result.m_error = "Another target is in the same directory";
+        }
+        batch->m_results.push_back(result);
+    }
+    if (batch->m_targets.empty()) {
+        this->CallAfter([this, batch]() -> void {
+            this->continueBatchInstall(batch);
+        });
+        return;
+    }
+
+    // every install needs the library, but it 
+    // only has to be downloaded once
+    this->installGeodeUtilsLib(
+        false,
+        branch,
+        [this, batch](std::string const& error) -> void {
+            for (auto index : batch->m_targets) {
+                auto& result = batch->m_results.at(index);
+                result.m_error = "Unable to install the Geode Utility Library: " + error;
+            }
+            batch->m_next = batch->m_targets.size();
+            this->continueBatchInstall(batch);
+        },
+        [batch](std::string const& text, int progress) -> void {
+            if (!batch->m_progressFunc) return;
+            for (auto index : batch->m_targets) {
+                batch->m_progressFunc(index, "Downloading Geode Utility Library: " + text, progress);
+            }
+        },
+        [this, batch]() -> void {
+            this->continueBatchInstall(batch);
+        }
+    );
+}
+
 Result<> Manager::uninstallGeodeFrom(Installation const& inst) {
     #ifdef _WIN32
 
     ghc::filesystem::path path(inst.m_path);
-    if (ghc::filesystem::exists(path / "geode")) {
-        ghc::filesystem::remove_all(path / "geode");
-    }
-    if (ghc::filesystem::exists(path / "XInput9_1_0.dll")) {
-        ghc::filesystem::remove(path / "XInput9_1_0.dll");
-    }
-    if (ghc::filesystem::exists(path / "Geode.dll")) {
-        ghc::filesystem::remove(path / "Geode.dll");
+    try {
+        if (ghc::filesystem::exists(path / "geode")) {
+            ghc::filesystem::remove_all(path / "geode");
+        }
+        if (ghc::filesystem::exists(path / "XInput9_1_0.dll")) {
+            ghc::filesystem::remove(path / "XInput9_1_0.dll");
+        }
+        if (ghc::filesystem::exists(path / "Geode.dll")) {
+            ghc::filesystem::remove(path / "Geode.dll");
+        }
+    } catch(std::exception& e) {
+        return Err(std::string(e.what()));
     }
     return Ok();
 
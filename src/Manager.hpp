@@ -8,8 +8,15 @@
 #include "legacy/optional.hpp"
 #include <wx/webrequest.h>
 #include <functional>
+#include <memory>
 #include "include/VersionInfo.hpp"
 #include "include/json.hpp"
+#include "HttpCache.hpp"
+#include "ArtifactStore.hpp"
+#include "JobScheduler.hpp"
+#include "CancelToken.hpp"
+#include "ProgressSlot.hpp"
+#include <chrono>
 
 enum class DevBranch : bool {
     Stable,
@@ -59,9 +66,59 @@ enum class InstallerMode {
 
 using DownloadErrorFunc = std::function<void(std::string const&)>;
 using DownloadProgressFunc = std::function<void(std::string const&, int)>;
-using DownloadFinishFunc = std::function<void(wxWebResponse const&)>;
+using FetchFinishFunc = std::function<void(std::string const&)>;
+using DownloadFileFinishFunc = std::function<void(ghc::filesystem::path const&)>;
 using CloneFinishFunc = std::function<void()>;
+using DownloadDataFunc = std::function<Result<>(void const*, size_t)>;
+using ReleaseAssetFunc = std::function<void(std::string const&, std::string const&, std::string const&)>;
 using UpdateCheckFinishFunc = std::function<void(VersionInfo const&, VersionInfo const&)>;
+using VersionsFetchFunc = std::function<void(nlohmann::json const&)>;
+using WebRequestStateFunc = std::function<void(wxWebRequestEvent&)>;
+using WebRequestDataFunc = std::function<void(wxWebRequestEvent&)>;
+
+/**
+ * Outcome of checking the CLI or one 
+ * installation for updates. If the check 
+ * failed, m_error holds the reason
+ */
+struct UpdateCheckResult {
+    VersionInfo m_current;
+    VersionInfo m_available;
+    std::string m_error;
+
+    inline bool isUpdateAvailable() const {
+        return m_error.empty() && m_current < m_available;
+    }
+};
+
+/**
+ * Results of Manager::checkAllForUpdates. 
+ * m_installations is in the same order as 
+ * Manager::getInstallations()
+ */
+struct UpdateCheckTable {
+    UpdateCheckResult m_cli;
+    std::vector<UpdateCheckResult> m_installations;
+};
+
+using UpdateCheckAllFinishFunc = std::function<void(UpdateCheckTable const&)>;
+
+/**
+ * Outcome of installing Geode into one of the 
+ * targets of Manager::installGeodeForAll. If 
+ * the install failed, m_error holds the reason
+ */
+struct BatchInstallResult {
+    ghc::filesystem::path m_gdExePath;
+    std::string m_error;
+
+    inline bool isOk() const {
+        return m_error.empty();
+    }
+};
+
+using BatchInstallProgressFunc = std::function<void(size_t, std::string const&, int)>;
+using BatchInstallFinishFunc = std::function<void(std::vector<BatchInstallResult> const&)>;
 
 class GeodeInstallerApp;
 
@@ -69,6 +126,18 @@ namespace cli {
     using ProgressCallback = void(__stdcall*)(const char*, int);
     using geode_install_geode = const char*(__cdecl*)(const char*, bool, bool, ProgressCallback);
     using geode_install_suite = const char*(__cdecl*)(const char*, bool, ProgressCallback);
+
+    // v2 hands the userdata it's given back to every 
+    // progress callback, so several operations can 
+    // report their progress at the same time. Older 
+    // libraries only export the functions above
+    using ProgressCallbackV2 = void(__stdcall*)(const char*, int, void*);
+    using geode_install_geode_v2 = const char*(__cdecl*)(
+        const char*, bool, bool, ProgressCallbackV2, void*
+    );
+    using geode_install_suite_v2 = const char*(__cdecl*)(
+        const char*, bool, ProgressCallbackV2, void*
+    );
 }
 
 class CallOnMainEvent : public wxEvent {
@@ -86,6 +155,32 @@ public:
     wxEvent* Clone() const override { return new CallOnMainEvent(*this); }
 };
 
+wxDECLARE_EVENT(CALL_ON_MAIN, CallOnMainEvent);
+
+/**
+ * A web request in flight. Manager routes 
+ * the state events of the request to its 
+ * handler by the request's ID
+ */
+struct WebRequestHandler {
+    wxWebRequest m_request;
+    WebRequestStateFunc m_stateFunc;
+    WebRequestDataFunc m_dataFunc;
+    std::shared_ptr<CancelToken> m_cancelToken;
+    size_t m_cancelCallback = 0;
+};
+
+/**
+ * A caller waiting on the result of a 
+ * download that may be shared with other 
+ * callers asking for the same thing
+ */
+struct InFlightWaiter {
+    DownloadErrorFunc m_errorFunc;
+    DownloadProgressFunc m_progressFunc;
+    DownloadFileFinishFunc m_finishFunc;
+};
+
 class Manager : public wxEvtHandler {
 protected:
     ghc::filesystem::path m_dataDirectory;
@@ -99,6 +194,21 @@ protected:
     ghc::filesystem::path m_loaderUpdatePath;
     nlohmann::json m_loadedConfigJson;
     VersionInfo m_CLIVersion;
+    std::unordered_map<int, std::shared_ptr<WebRequestHandler>> m_webRequests;
+    int m_nextWebRequestID = 1;
+    size_t m_downloadSegments = 4;
+    bool m_shareInstallFiles = true;
+    HttpCache m_httpCache;
+    ArtifactStore m_artifactStore;
+    JobScheduler m_jobScheduler;
+    // cancelled once the installer is closing
+    std::shared_ptr<CancelToken> m_cancelToken = CancelToken::create();
+    std::vector<std::pair<std::shared_ptr<ProgressSlot>, DownloadProgressFunc>> m_progressSlots;
+    wxTimer m_progressTimer;
+    std::unordered_map<std::string, std::vector<InFlightWaiter>> m_inFlight;
+    std::unordered_map<std::string, ghc::filesystem::path> m_prefetched;
+
+    Manager();
 
     void* loadFunctionFromUtilsLib(const char* name);
     template<typename Func>
@@ -106,24 +216,220 @@ protected:
         return reinterpret_cast<Func>(this->loadFunctionFromUtilsLib(name));
     }
 
-    void webRequest(
+    /**
+     * Wrap a callback so it's dropped once the 
+     * operations have been cancelled, since the 
+     * page that passed it may be gone by then
+     */
+    template<typename... Args>
+    std::function<void(Args...)> unlessCancelled(std::function<void(Args...)> func) const {
+        if (!func) return nullptr;
+        auto token = m_cancelToken;
+        return [token, func](Args... args) -> void {
+            if (!token->isCancelled()) func(args...);
+        };
+    }
+
+    /**
+     * Create a web request whose state events 
+     * are routed to stateFunc, and whose data 
+     * events (for requests using Storage_None) 
+     * are routed to dataFunc. The handler is 
+     * dropped once the request reaches a 
+     * terminal state. The request still needs 
+     * to be started by the caller. Cancelling 
+     * the token cancels the request
+     */
+    wxWebRequest createWebRequest(
+        std::string const& url,
+        WebRequestStateFunc stateFunc,
+        WebRequestDataFunc dataFunc = nullptr,
+        std::shared_ptr<CancelToken> const& cancelToken = nullptr
+    );
+    /**
+     * Add a waiter for the operation identified 
+     * by key. Returns true if an identical 
+     * operation is already in flight, in which 
+     * case the waiter receives its result and 
+     * the caller must not start another one
+     */
+    bool joinInFlight(std::string const& key, InFlightWaiter const& waiter);
+    void progressInFlight(std::string const& key, std::string const& text, int progress);
+    void finishInFlight(std::string const& key, ghc::filesystem::path const& path);
+    void failInFlight(std::string const& key, std::string const& error);
+    /**
+     * GET a URL through the on-disk response 
+     * cache. If the cached copy is younger 
+     * than maxAge it's used without touching 
+     * the network; otherwise a conditional 
+     * request is sent and a 304 is served from 
+     * the cache. finishFunc receives the path 
+     * of the cached body
+     */
+    void fetchFile(
+        std::string const& url,
+        std::chrono::seconds maxAge,
+        DownloadErrorFunc errorFunc,
+        DownloadFileFinishFunc finishFunc
+    );
+    void fetch(
+        std::string const& url,
+        std::chrono::seconds maxAge,
+        DownloadErrorFunc errorFunc,
+        FetchFinishFunc finishFunc
+    );
+    /**
+     * Download a file into target. If sha256 is 
+     * given, the file is checked against it as it 
+     * downloads and rejected if it doesn't match
+     */
+    void downloadFile(
+        std::string const& url,
+        ghc::filesystem::path const& target,
+        DownloadErrorFunc errorFunc,
+        DownloadProgressFunc progressFunc,
+        DownloadFileFinishFunc finishFunc,
+        std::string const& sha256 = ""
+    );
+    /**
+     * Put the artifact at url into target through 
+     * the artifact store. If the store already 
+     * has it (by its SHA-256, or failing that by 
+     * what the URL served less than maxAge ago), 
+     * nothing is downloaded; otherwise it's 
+     * downloaded into the store first. If 
+     * allowHardlink is set, target may be a 
+     * hardlink to the stored copy, so it must 
+     * only ever be replaced, never written to
+     */
+    void fetchArtifact(
         std::string const& url,
-        bool downloadFile,
+        std::string const& sha256,
+        std::chrono::seconds maxAge,
+        ghc::filesystem::path const& target,
         DownloadErrorFunc errorFunc,
         DownloadProgressFunc progressFunc,
-        DownloadFinishFunc finishFunc
+        DownloadFileFinishFunc finishFunc,
+        bool allowHardlink = false
     );
-    Result<> unzipTo(
-        ghc::filesystem::path const& zip,
+    tl::optional<std::string> findArtifact(
+        std::string const& url,
+        std::string const& sha256,
+        std::chrono::seconds maxAge
+    ) const;
+    /**
+     * Download a file in the background without 
+     * anyone waiting for it. The next downloadFile 
+     * call for the same URL during this session 
+     * moves the prefetched file into its target 
+     * (or waits for the prefetch to finish) 
+     * instead of downloading it again
+     */
+    void prefetchFile(
+        std::string const& url,
+        ghc::filesystem::path const& target
+    );
+    /**
+     * Download a URL over a single connection, 
+     * handing the bytes to dataFunc in order as 
+     * they arrive instead of storing them
+     */
+    void streamDownload(
+        std::string const& url,
+        DownloadDataFunc dataFunc,
+        DownloadErrorFunc errorFunc,
+        DownloadProgressFunc progressFunc,
+        CloneFinishFunc finishFunc
+    );
+    /**
+     * Find the name, download URL and SHA-256 
+     * of the CLI release asset for this platform
+     */
+    void findCLIAsset(
+        DownloadErrorFunc errorFunc,
+        DownloadProgressFunc progressFunc,
+        ReleaseAssetFunc finishFunc
+    );
+    /**
+     * Fetch and parse versions.json for 
+     * the given branch
+     */
+    void fetchVersions(
+        DevBranch branch,
+        DownloadErrorFunc errorFunc,
+        VersionsFetchFunc finishFunc
+    );
+    /**
+     * Create a staging directory next to the bin 
+     * directory, seeded with hardlinks to the 
+     * current files, for an update to be 
+     * extracted into
+     */
+    Result<ghc::filesystem::path> prepareBinStaging();
+    /**
+     * Swap the staging directory in place of the 
+     * bin directory, keeping the current one 
+     * around for rollbackCLI
+     */
+    Result<> promoteBinStaging();
+    /**
+     * Extract a zip or .tar.zst archive, skipping 
+     * files left unchanged since the last time
+     */
+    Result<> extractArchiveTo(
+        ghc::filesystem::path const& archive,
         ghc::filesystem::path const& to
     );
     Result<> addSuiteEnv();
+    /**
+     * Files the loader puts into a GD directory 
+     * that are the same for every installation 
+     * of the same version
+     */
+    std::vector<ghc::filesystem::path> getSharedLoaderFiles(
+        ghc::filesystem::path const& installPath
+    ) const;
+    /**
+     * Replace the loader files of an installation 
+     * with reflinks to the copies in the artifact 
+     * store, adding them there first if needed. 
+     * Does nothing unless the store and the 
+     * installation are on one volume that 
+     * supports reflinks. Failures are ignored, 
+     * as the files are fine as they are
+     */
+    void shareLoaderFiles(ghc::filesystem::path const& installPath);
+    /**
+     * Start as many of the remaining installs of 
+     * a batch as its parallelism allows, or wrap 
+     * it up once they're all done
+     */
+    struct BatchInstall;
+    void continueBatchInstall(std::shared_ptr<BatchInstall> batch);
  
+    /**
+     * Report the progress a worker puts into the 
+     * slot to func, once per frame at most, until 
+     * unwatchProgress. A slot only referenced by 
+     * the watch list anymore (its operation was 
+     * dropped) is unwatched automatically
+     */
+    void watchProgress(std::shared_ptr<ProgressSlot> slot, DownloadProgressFunc func);
+    /**
+     * Report the last progress of the slot that 
+     * hasn't been yet and stop watching it
+     */
+    void unwatchProgress(std::shared_ptr<ProgressSlot> const& slot);
+
     void onSyncThreadCall(CallOnMainEvent&);
+    void onProgressTimer(wxTimerEvent&);
+    void onWebRequestState(wxWebRequestEvent&);
+    void onWebRequestData(wxWebRequestEvent&);
 
     void addInstallation(Installation const& inst);
 
     friend class GeodeInstallerApp;
+    friend class Download;
 
 public:
     static Manager* get();
@@ -150,16 +456,98 @@ public:
     Result<> saveData();
     Result<> deleteData();
 
+    /**
+     * The pool long operations (installs, 
+     * extraction) run on instead of threads 
+     * of their own
+     */
+    JobScheduler& getJobScheduler();
+    /**
+     * Cancel every operation, wait for the ones 
+     * running on the worker threads to stop and 
+     * stop the workers. Operations that haven't 
+     * started yet are dropped, and no callbacks 
+     * are called afterwards
+     */
+    void shutdown();
+
+    /**
+     * Start fetching what the install flow is 
+     * going to need while the user is still 
+     * going through the earlier pages. Errors 
+     * are ignored; the actual install will 
+     * just try again
+     */
+    void prefetchReleaseData();
+    void prefetchGeodeUtilsLib(DevBranch branch);
+
+    /**
+     * How many parallel connections to use at 
+     * most when downloading large files from 
+     * servers that support Range requests
+     */
+    size_t getDownloadSegments() const;
+    void setDownloadSegments(size_t segments);
+
+    /**
+     * How big the store of downloaded artifacts 
+     * may get, in bytes, before the least 
+     * recently used ones are deleted
+     */
+    uint64_t getArtifactStoreBudget() const;
+    void setArtifactStoreBudget(uint64_t budget);
+
+    /**
+     * Whether the loader files of installations 
+     * should share their data on disk with each 
+     * other, as reflinks to a copy in the 
+     * artifact store. On by default, as it only 
+     * takes effect where reflinks are supported
+     */
+    bool getShareInstallFiles() const;
+    void setShareInstallFiles(bool share);
+
     void downloadCLI(
         DownloadErrorFunc errorFunc,
         DownloadProgressFunc progressFunc,
-        DownloadFinishFunc finishFunc
+        DownloadFileFinishFunc finishFunc
     );
     Result<> installCLI(
-        ghc::filesystem::path const& cliZipPath
+        ghc::filesystem::path const& cliArchivePath
+    );
+    /**
+     * Install the CLI from an archive as a job on 
+     * the scheduler, reporting back on the main 
+     * thread
+     */
+    void installCLI(
+        ghc::filesystem::path const& cliArchivePath,
+        DownloadErrorFunc errorFunc,
+        CloneFinishFunc finishFunc
     );
+    /**
+     * Download the CLI and extract it while it's 
+     * being downloaded, without storing the zip
+     */
+    void streamInstallCLI(
+        DownloadErrorFunc errorFunc,
+        DownloadProgressFunc progressFunc,
+        CloneFinishFunc finishFunc
+    );
+
+    /**
+     * Go back to the CLI that was installed before 
+     * the last update. Only takes a couple of 
+     * renames, since the previous bin directory 
+     * is kept until the next update along with 
+     * its version, which is saved as the 
+     * current version again
+     */
+    Result<> rollbackCLI();
+    bool canRollbackCLI() const;
 
     void setCLIVersion(VersionInfo const&);
+    VersionInfo getCLIVersion() const;
 
     Result<> addCLIToPath();
     Result<> installSuite(
@@ -180,6 +568,17 @@ public:
         DownloadErrorFunc errorFunc,
         UpdateCheckFinishFunc finishFunc
     );
+    /**
+     * Check the CLI (if the suite is installed) 
+     * and every installation for updates at 
+     * once. versions.json is fetched at most 
+     * once per branch no matter how many 
+     * installations there are; failures are 
+     * reported per entry in the result table
+     */
+    void checkAllForUpdates(
+        UpdateCheckAllFinishFunc finishFunc
+    );
 
     void installGeodeUtilsLib(
         bool update,
@@ -197,6 +596,28 @@ public:
         DownloadProgressFunc progressFunc,
         CloneFinishFunc finishFunc
     );
+    /**
+     * Install Geode into every given GD executable, 
+     * at most parallelism of them at a time. This 
+     * is capped at one less than the worker thread 
+     * count (which is also the default for 0), so 
+     * the installs never hold up other jobs on the 
+     * scheduler. The utils library 
+     * is installed once for all of them. Progress 
+     * is reported per target by its index in the 
+     * list, and the results are in the same order. 
+     * The installations are saved once, after the 
+     * last install is done. A target in the same 
+     * directory as an earlier one fails, as two 
+     * installs can't write to the same files
+     */
+    void installGeodeForAll(
+        std::vector<ghc::filesystem::path> const& gdExePaths,
+        DevBranch branch,
+        size_t parallelism,
+        BatchInstallProgressFunc progressFunc,
+        BatchInstallFinishFunc finishFunc
+    );
     Result<> uninstallGeodeFrom(Installation const& installation);
     Result<> deleteSaveDataFrom(Installation const& installation);
 
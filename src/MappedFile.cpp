@@ -0,0 +1,89 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+Result<std::shared_ptr<MappedFile>> MappedFile::open(ghc::filesystem::path const& path) {
+    auto file = std::shared_ptr<MappedFile>(new MappedFile());
+
+    #ifdef _WIN32
+
+    auto handle = CreateFileW(
+        path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (handle == INVALID_HANDLE_VALUE) {
+        return Err("Unable to open \"" + path.string() + "\"");
+    }
+    file->m_file = handle;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        return Err("Unable to read the size of \"" + path.string() + "\"");
+    }
+    file->m_size = static_cast<size_t>(size.QuadPart);
+    // empty files can't be mapped
+    if (!file->m_size) {
+        return Ok(file);
+    }
+    file->m_mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!file->m_mapping) {
+        return Err("Unable to map \"" + path.string() + "\"");
+    }
+    file->m_data = static_cast<uint8_t const*>(
+        MapViewOfFile(file->m_mapping, FILE_MAP_READ, 0, 0, 0)
+    );
+    if (!file->m_data) {
+        return Err("Unable to map \"" + path.string() + "\"");
+    }
+
+    #else
+
+    file->m_file = ::open(path.c_str(), O_RDONLY);
+    if (file->m_file < 0) {
+        return Err("Unable to open \"" + path.string() + "\"");
+    }
+    struct stat info;
+    if (fstat(file->m_file, &info) != 0) {
+        return Err("Unable to read the size of \"" + path.string() + "\"");
+    }
+    file->m_size = static_cast<size_t>(info.st_size);
+    if (!file->m_size) {
+        return Ok(file);
+    }
+    auto data = mmap(nullptr, file->m_size, PROT_READ, MAP_PRIVATE, file->m_file, 0);
+    if (data == MAP_FAILED) {
+        return Err("Unable to map \"" + path.string() + "\"");
+    }
+    file->m_data = static_cast<uint8_t const*>(data);
+    // the whole file is usually about to be read
+    madvise(data, file->m_size, MADV_WILLNEED);
+
+    #endif
+
+    return Ok(file);
+}
+
+MappedFile::~MappedFile() {
+    #ifdef _WIN32
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file) CloseHandle(m_file);
+    #else
+    if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+    if (m_file >= 0) close(m_file);
+    #endif
+}
+
+uint8_t const* MappedFile::getData() const {
+    return m_data;
+}
+
+size_t MappedFile::getSize() const {
+    return m_size;
+}
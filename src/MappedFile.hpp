@@ -0,0 +1,33 @@
+#pragma once
+
+#include "legacy/filesystem.hpp"
+#include "include/Result.hpp"
+#include <memory>
+#include <cstdint>
+
+/**
+ * A file mapped read-only into memory
+ */
+class MappedFile {
+protected:
+    uint8_t const* m_data = nullptr;
+    size_t m_size = 0;
+    #ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+    #else
+    int m_file = -1;
+    #endif
+
+    MappedFile() = default;
+
+public:
+    static Result<std::shared_ptr<MappedFile>> open(ghc::filesystem::path const& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    uint8_t const* getData() const;
+    size_t getSize() const;
+};
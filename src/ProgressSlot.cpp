@@ -0,0 +1,54 @@
+#include "ProgressSlot.hpp"
+#include <cstring>
+
+ProgressSlot::ProgressSlot() {
+    for (auto& word : m_text) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+void ProgressSlot::set(const char* text, int percent) {
+    auto seq = m_sequence.load(std::memory_order_relaxed);
+    if (
+        (seq & 1) ||
+        !m_sequence.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)
+    ) {
+        return;
+    }
+    // the words are atomic so the reader copying
+    // them out mid-write isn't a data race; it's
+    // told to throw away what it read instead
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint64_t words[TEXT_WORDS] = {};
+    if (text) {
+        // always leaves the last byte zeroed
+        std::strncpy(reinterpret_cast<char*>(words), text, sizeof(words) - 1);
+    }
+    for (size_t i = 0; i < TEXT_WORDS; i++) {
+        m_text[i].store(words[i], std::memory_order_relaxed);
+    }
+    m_percent.store(percent, std::memory_order_relaxed);
+
+    m_sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool ProgressSlot::take(std::string& text, int& percent) {
+    auto seq = m_sequence.load(std::memory_order_acquire);
+    if ((seq & 1) || seq == m_taken) {
+        return false;
+    }
+    uint64_t words[TEXT_WORDS];
+    for (size_t i = 0; i < TEXT_WORDS; i++) {
+        words[i] = m_text[i].load(std::memory_order_relaxed);
+    }
+    auto value = m_percent.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_sequence.load(std::memory_order_relaxed) != seq) {
+        return false;
+    }
+    m_taken = seq;
+    text.assign(reinterpret_cast<char const*>(words));
+    percent = value;
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * The latest progress of an operation running
+ * on another thread. The worker overwrites it
+ * as often as it likes without allocating or
+ * locking, and the main thread picks up only
+ * the newest value once per frame, so a storm
+ * of updates (cloning submodules) can't flood
+ * the event queue.
+ * 
+ * A seqlock: the sequence number is odd while
+ * a write is in progress, and a read is only
+ * accepted if the sequence didn't change while
+ * the value was being copied out. One thread
+ * may take() at a time
+ */
+class ProgressSlot {
+protected:
+    // status texts are cut off at 255 bytes
+    static constexpr size_t TEXT_WORDS = 32;
+
+    std::atomic<uint32_t> m_sequence = 0;
+    std::atomic<uint64_t> m_text[TEXT_WORDS];
+    std::atomic<int> m_percent = 0;
+    // sequence of the last value taken
+    uint32_t m_taken = 0;
+
+public:
+    ProgressSlot();
+
+    ProgressSlot(ProgressSlot const&) = delete;
+    ProgressSlot& operator=(ProgressSlot const&) = delete;
+
+    /**
+     * Replace the value. If another thread is
+     * writing at the same moment, this update
+     * is dropped in favor of that one
+     */
+    void set(const char* text, int percent);
+    /**
+     * Copy out the value if it changed since the
+     * last take(). Returns false if it didn't or
+     * if it's being written right now; it can
+     * just be picked up on the next frame then
+     */
+    bool take(std::string& text, int& percent);
+};
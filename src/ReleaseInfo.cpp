@@ -0,0 +1,172 @@
+#include "ReleaseInfo.hpp"
+#include "include/json.hpp"
+#include <fstream>
+
+using json = nlohmann::json;
+
+/**
+ * Depth counts the containers we're inside of:
+ * the release object is depth 1, the assets
+ * array depth 2 and each asset object depth 3
+ */
+class ReleaseSax : public nlohmann::json_sax<json> {
+protected:
+    ReleaseInfo& m_info;
+    size_t m_depth = 0;
+    std::string m_key;
+    bool m_hasTag = false;
+    bool m_inAssets = false;
+    bool m_hasAssets = false;
+
+    bool done() const {
+        return m_hasTag && m_hasAssets;
+    }
+
+    bool value() {
+        m_key.clear();
+        return true;
+    }
+
+public:
+    std::string m_error;
+
+    ReleaseSax(ReleaseInfo& info) : m_info(info) {}
+
+    bool isComplete() const {
+        return this->done();
+    }
+
+    bool null() override {
+        return this->value();
+    }
+    bool boolean(bool) override {
+        return this->value();
+    }
+    bool number_integer(number_integer_t) override {
+        return this->value();
+    }
+    bool number_unsigned(number_unsigned_t) override {
+        return this->value();
+    }
+    bool number_float(number_float_t, string_t const&) override {
+        return this->value();
+    }
+    bool binary(binary_t&) override {
+        return this->value();
+    }
+
+    bool string(string_t& val) override {
+        if (m_depth == 1 && m_key == "tag_name") {
+            m_info.m_tagName = std::move(val);
+            m_hasTag = true;
+        }
+        else if (m_inAssets && m_depth == 3 && m_info.m_assets.size()) {
+            if (m_key == "name") {
+                m_info.m_assets.back().m_name = std::move(val);
+            }
+            else if (m_key == "browser_download_url") {
+                m_info.m_assets.back().m_url = std::move(val);
+            }
+            // "sha256:<hex>"; other algorithms are ignored
+            else if (m_key == "digest" && val.rfind("sha256:", 0) == 0) {
+                m_info.m_assets.back().m_sha256 = val.substr(7);
+            }
+        }
+        this->value();
+        // returning false stops the parser
+        return !this->done();
+    }
+
+    bool key(string_t& val) override {
+        m_key = std::move(val);
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        if (m_inAssets && m_depth == 2) {
+            m_info.m_assets.push_back({});
+        }
+        m_depth++;
+        return this->value();
+    }
+
+    bool end_object() override {
+        m_depth--;
+        return this->value();
+    }
+
+    bool start_array(std::size_t) override {
+        if (m_depth == 1 && m_key == "assets") {
+            m_inAssets = true;
+        }
+        m_depth++;
+        return this->value();
+    }
+
+    bool end_array() override {
+        m_depth--;
+        if (m_inAssets && m_depth == 1) {
+            m_inAssets = false;
+            m_hasAssets = true;
+        }
+        this->value();
+        return !this->done();
+    }
+
+    bool parse_error(
+        std::size_t,
+        std::string const&,
+        nlohmann::detail::exception const& ex
+    ) override {
+        m_error = ex.what();
+        return false;
+    }
+};
+
+tl::optional<ReleaseAsset> ReleaseInfo::findAsset(std::string const& identifier) const {
+    for (auto& asset : m_assets) {
+        if (asset.m_name.find(identifier) != std::string::npos) {
+            return asset;
+        }
+    }
+    return tl::nullopt;
+}
+
+tl::optional<ReleaseAsset> ReleaseInfo::findAsset(
+    std::string const& identifier,
+    std::vector<std::string> const& extensions
+) const {
+    for (auto& ext : extensions) {
+        for (auto& asset : m_assets) {
+            if (
+                asset.m_name.find(identifier) != std::string::npos &&
+                asset.m_name.size() >= ext.size() &&
+                asset.m_name.compare(asset.m_name.size() - ext.size(), ext.size(), ext) == 0
+            ) {
+                return asset;
+            }
+        }
+    }
+    return tl::nullopt;
+}
+
+Result<ReleaseInfo> parseRelease(std::istream& stream) {
+    ReleaseInfo info;
+    ReleaseSax sax(info);
+    json::sax_parse(stream, &sax);
+    if (sax.m_error.size()) {
+        return Err("Unable to parse JSON: " + sax.m_error);
+    }
+    if (!sax.isComplete()) {
+        return Err("Release has no tag name or assets");
+    }
+    return Ok(info);
+}
+
+Result<ReleaseInfo> parseRelease(ghc::filesystem::path const& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs.is_open()) {
+        return Err("Unable to open \"" + path.string() + "\"");
+    }
+    return parseRelease(ifs);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "legacy/filesystem.hpp"
+#include "legacy/optional.hpp"
+#include "include/Result.hpp"
+#include <istream>
+#include <string>
+#include <vector>
+
+struct ReleaseAsset {
+    std::string m_name;
+    std::string m_url;
+    /**
+     * Hex SHA-256 of the asset as published by 
+     * GitHub, or empty if the release predates 
+     * asset digests
+     */
+    std::string m_sha256;
+};
+
+/**
+ * The parts of a GitHub release the
+ * installer cares about
+ */
+struct ReleaseInfo {
+    std::string m_tagName;
+    std::vector<ReleaseAsset> m_assets;
+
+    /**
+     * Find the first asset whose name
+     * contains the given identifier
+     */
+    tl::optional<ReleaseAsset> findAsset(std::string const& identifier) const;
+    /**
+     * Find an asset whose name contains the given 
+     * identifier, preferring the extensions in the 
+     * order they're given in. Assets with none of 
+     * the extensions aren't considered
+     */
+    tl::optional<ReleaseAsset> findAsset(
+        std::string const& identifier,
+        std::vector<std::string> const& extensions
+    ) const;
+};
+
+/**
+ * Pull the tag name and assets out of a GitHub
+ * release document without building the JSON
+ * DOM. Parsing stops as soon as both have been
+ * read, so the (potentially huge) release notes
+ * after the assets are never looked at
+ */
+Result<ReleaseInfo> parseRelease(std::istream& stream);
+Result<ReleaseInfo> parseRelease(ghc::filesystem::path const& path);
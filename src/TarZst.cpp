@@ -0,0 +1,434 @@
+#include "TarZst.hpp"
+
+#ifdef GEODE_HAS_ZSTD
+
+#include "Zip.hpp"
+#include <zstd.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAR_BLOCK_SIZE 512
+// long names and pax headers bigger than
+// this are certainly not legitimate
+#define TAR_MAX_META_SIZE (1024 * 1024)
+// how far the decoder may get ahead of the disk
+#define MAX_QUEUED_BYTES (32 * 1024 * 1024)
+
+static uint64_t parseOctal(uint8_t const* p, size_t size) {
+    // GNU tar stores big numbers in base-256
+    if (p[0] & 0x80) {
+        uint64_t value = p[0] & 0x7f;
+        for (size_t i = 1; i < size; i++) {
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+    size_t i = 0;
+    while (i < size && (p[i] == ' ' || p[i] == '\0')) i++;
+    uint64_t value = 0;
+    while (i < size && p[i] >= '0' && p[i] <= '7') {
+        value = value * 8 + (p[i] - '0');
+        i++;
+    }
+    return value;
+}
+
+static std::string parseString(uint8_t const* p, size_t size) {
+    auto str = reinterpret_cast<char const*>(p);
+    return std::string(str, std::find(str, str + size, '\0'));
+}
+
+static uint64_t paddingFor(uint64_t size) {
+    return (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+}
+
+TarZstExtractor::TarZstExtractor(
+    ghc::filesystem::path const& target,
+    bool sync,
+    std::shared_ptr<CancelToken> const& cancelToken
+) : m_target(target), m_batch(sync), m_cancelToken(cancelToken) {
+    m_stream = ZSTD_createDStream();
+    m_output.resize(ZSTD_DStreamOutSize());
+    m_writer = std::thread(&TarZstExtractor::runWriter, this);
+}
+
+TarZstExtractor::~TarZstExtractor() {
+    this->stopWriter();
+    ZSTD_freeDStream(m_stream);
+}
+
+Err<> TarZstExtractor::fail(std::string const& error) {
+    m_state = State::Failed;
+    m_error = error;
+    return Err(error);
+}
+
+bool TarZstExtractor::fill(uint8_t const*& data, size_t& size) {
+    auto take = std::min(m_need - m_buffer.size(), size);
+    m_buffer.insert(m_buffer.end(), data, data + take);
+    data += take;
+    size -= take;
+    return m_buffer.size() == m_need;
+}
+
+Result<> TarZstExtractor::write(void const* data, size_t size) {
+    if (m_state == State::Failed) {
+        return Err(m_error);
+    }
+    if (m_cancelToken && m_cancelToken->isCancelled()) {
+        return this->fail("Cancelled");
+    }
+    if (!m_stream) {
+        return this->fail("Unable to initialize zstd");
+    }
+    if (!size) {
+        return Ok();
+    }
+    ZSTD_inBuffer in { data, size, 0 };
+    auto outputFull = false;
+    // a full output buffer may mean there's more
+    // to flush even after all input is consumed
+    while (in.pos < in.size || outputFull) {
+        auto consumed = in.pos;
+        ZSTD_outBuffer out { m_output.data(), m_output.size(), 0 };
+        auto ret = ZSTD_decompressStream(m_stream, &out, &in);
+        if (ZSTD_isError(ret)) {
+            return this->fail(
+                "Unable to decompress archive: " + std::string(ZSTD_getErrorName(ret))
+            );
+        }
+        if (in.pos != consumed || out.pos) {
+            m_frameDone = ret == 0;
+        }
+        outputFull = out.pos == out.size;
+        auto res = this->process(m_output.data(), out.pos);
+        if (!res) return res;
+    }
+    return Ok();
+}
+
+Result<> TarZstExtractor::process(uint8_t const* data, size_t size) {
+    while (size) {
+        switch (m_state) {
+            case State::Header: {
+                if (!this->fill(data, size)) break;
+                auto res = this->parseHeader();
+                if (!res) return res;
+            } break;
+
+            case State::LongName: {
+                if (!this->fill(data, size)) break;
+                m_nextName = parseString(m_buffer.data(), m_buffer.size());
+                m_buffer.clear();
+                m_need = TAR_BLOCK_SIZE;
+                m_state = State::Header;
+            } break;
+
+            case State::PaxHeader: {
+                if (!this->fill(data, size)) break;
+                this->parsePaxHeader();
+                m_buffer.clear();
+                m_need = TAR_BLOCK_SIZE;
+                m_state = State::Header;
+            } break;
+
+            case State::Data: {
+                auto take = static_cast<size_t>(std::min<uint64_t>(m_remaining, size));
+                WriteJob job { WriteJob::Type::Data };
+                job.m_data.assign(data, data + take);
+                auto res = this->queue(std::move(job));
+                if (!res) return res;
+                data += take;
+                size -= take;
+                m_remaining -= take;
+                if (!m_remaining) {
+                    auto res = this->queue({ WriteJob::Type::Close });
+                    if (!res) return res;
+                    m_remaining = m_padding;
+                    m_state = m_remaining ? State::Skip : State::Header;
+                    m_need = TAR_BLOCK_SIZE;
+                }
+            } break;
+
+            case State::Skip: {
+                auto take = static_cast<size_t>(std::min<uint64_t>(m_remaining, size));
+                data += take;
+                size -= take;
+                m_remaining -= take;
+                if (!m_remaining) {
+                    m_state = State::Header;
+                    m_need = TAR_BLOCK_SIZE;
+                }
+            } break;
+
+            // everything after the end marker is padding
+            case State::End: {
+                size = 0;
+            } break;
+
+            case State::Failed: {
+                return Err(m_error);
+            } break;
+        }
+    }
+    return Ok();
+}
+
+Result<> TarZstExtractor::parseHeader() {
+    auto p = m_buffer.data();
+    if (std::all_of(p, p + TAR_BLOCK_SIZE, [](uint8_t b) { return b == 0; })) {
+        m_buffer.clear();
+        m_state = State::End;
+        return Ok();
+    }
+
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) {
+        checksum += i >= 148 && i < 156 ? ' ' : p[i];
+    }
+    if (checksum != parseOctal(p + 148, 8)) {
+        return this->fail("Archive has a corrupted tar header");
+    }
+
+    auto size = parseOctal(p + 124, 12);
+    auto mode = static_cast<uint32_t>(parseOctal(p + 100, 8) & 0777);
+    auto type = static_cast<char>(p[156]);
+    auto name = parseString(p, 100);
+    if (std::memcmp(p + 257, "ustar", 5) == 0) {
+        auto prefix = parseString(p + 345, 155);
+        if (prefix.size()) {
+            name = prefix + "/" + name;
+        }
+    }
+    m_buffer.clear();
+
+    switch (type) {
+        // GNU long name and pax headers describe
+        // the entry that comes after them
+        case 'L': case 'x': {
+            if (size > TAR_MAX_META_SIZE) {
+                return this->fail("Archive has an oversized tar header");
+            }
+            m_state = type == 'L' ? State::LongName : State::PaxHeader;
+            m_need = static_cast<size_t>(size + paddingFor(size));
+            if (!m_need) {
+                m_need = TAR_BLOCK_SIZE;
+                m_state = State::Header;
+            }
+            return Ok();
+        } break;
+
+        // global pax headers and the like
+        case 'g': case 'V': {
+            m_state = State::Skip;
+            m_remaining = size + paddingFor(size);
+            m_need = TAR_BLOCK_SIZE;
+            if (!m_remaining) {
+                m_state = State::Header;
+            }
+            return Ok();
+        } break;
+
+        default: break;
+    }
+
+    if (m_nextName.size()) {
+        name = std::move(m_nextName);
+        m_nextName.clear();
+    }
+    while (name.rfind("./", 0) == 0) {
+        name.erase(0, 2);
+    }
+    while (name.size() && name.back() == '/') {
+        name.pop_back();
+    }
+
+    m_need = TAR_BLOCK_SIZE;
+    m_state = State::Header;
+    // the archive root
+    if (name.empty() || name == ".") {
+        return Ok();
+    }
+    if (!isSafeZipPath(name)) {
+        return this->fail("Archive entry \"" + name + "\" points outside the target");
+    }
+    auto path = m_target / ghc::filesystem::u8path(name);
+
+    switch (type) {
+        case '5': {
+            try {
+                ghc::filesystem::create_directories(path);
+            } catch(std::exception& e) {
+                return this->fail(e.what());
+            }
+        } break;
+
+        case '0': case '\0': case '7': {
+            try {
+                ghc::filesystem::create_directories(path.parent_path());
+            } catch(std::exception& e) {
+                return this->fail(e.what());
+            }
+            WriteJob job { WriteJob::Type::Open, path, size, mode };
+            auto res = this->queue(std::move(job));
+            if (!res) return res;
+            if (!size) {
+                return this->queue({ WriteJob::Type::Close });
+            }
+            m_state = State::Data;
+            m_remaining = size;
+            m_padding = paddingFor(size);
+        } break;
+
+        default: {
+            return this->fail(
+                "Archive entry \"" + name + "\" is a link or "
+                "special file, which isn't supported"
+            );
+        } break;
+    }
+    return Ok();
+}
+
+void TarZstExtractor::parsePaxHeader() {
+    // records look like "<length> <key>=<value>\n"
+    auto data = reinterpret_cast<char const*>(m_buffer.data());
+    size_t offset = 0;
+    while (offset < m_buffer.size()) {
+        auto space = std::find(data + offset, data + m_buffer.size(), ' ');
+        if (space == data + m_buffer.size()) break;
+        size_t length = 0;
+        for (auto c = data + offset; c < space; c++) {
+            if (*c < '0' || *c > '9') return;
+            length = length * 10 + (*c - '0');
+        }
+        if (!length || offset + length > m_buffer.size()) return;
+        std::string record(space + 1, data + offset + length);
+        if (record.size() && record.back() == '\n') {
+            record.pop_back();
+        }
+        if (record.rfind("path=", 0) == 0) {
+            m_nextName = record.substr(5);
+        }
+        offset += length;
+    }
+}
+
+Result<> TarZstExtractor::queue(WriteJob&& job) {
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_jobDone.wait(lock, [this]() -> bool {
+        return m_queuedBytes < MAX_QUEUED_BYTES || m_writeError.size();
+    });
+    if (m_writeError.size()) {
+        return this->fail(m_writeError);
+    }
+    m_queuedBytes += job.m_data.size();
+    m_jobs.push_back(std::move(job));
+    lock.unlock();
+    m_jobAdded.notify_one();
+    return Ok();
+}
+
+void TarZstExtractor::runWriter() {
+    FileWriter out;
+    ghc::filesystem::path path;
+    uint32_t mode = 0;
+    auto failed = false;
+    while (true) {
+        WriteJob job;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_jobAdded.wait(lock, [this]() -> bool {
+                return m_jobs.size() || m_closing;
+            });
+            if (m_jobs.empty()) return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        auto run = [&]() -> Result<> {
+            if (m_cancelToken) {
+                auto res = m_cancelToken->check();
+                if (!res) return res;
+            }
+            switch (job.m_type) {
+                case WriteJob::Type::Open: {
+                    path = job.m_path;
+                    mode = job.m_mode;
+                    // the file may be a hardlink to a file in use,
+                    // so replace it instead of writing through it
+                    std::error_code ec;
+                    ghc::filesystem::remove(path, ec);
+                    return out.open(path, job.m_size);
+                } break;
+
+                case WriteJob::Type::Data: {
+                    return out.write(job.m_data.data(), job.m_data.size());
+                } break;
+
+                case WriteJob::Type::Close: {
+                    auto res = out.finish(&m_batch);
+                    #ifndef _WIN32
+                    if (res && mode) {
+                        std::error_code ec;
+                        ghc::filesystem::permissions(
+                            path, static_cast<ghc::filesystem::perms>(mode), ec
+                        );
+                    }
+                    #endif
+                    return res;
+                } break;
+            }
+            return Ok();
+        };
+        // after an error the rest of the jobs are
+        // only drained so the decoder isn't blocked
+        auto res = failed ? Ok() : run();
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_queuedBytes -= job.m_data.size();
+            if (!res && !failed) {
+                failed = true;
+                m_writeError = res.error();
+            }
+        }
+        m_jobDone.notify_all();
+    }
+}
+
+void TarZstExtractor::stopWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_closing = true;
+    }
+    m_jobAdded.notify_all();
+    if (m_writer.joinable()) {
+        m_writer.join();
+    }
+}
+
+Result<> TarZstExtractor::finish() {
+    if (m_state == State::Failed) {
+        return Err(m_error);
+    }
+    // some archivers leave out the end marker
+    if (
+        !m_frameDone ||
+        (m_state != State::End && (m_state != State::Header || m_buffer.size()))
+    ) {
+        this->stopWriter();
+        return this->fail("Archive ended unexpectedly");
+    }
+    this->stopWriter();
+    if (m_writeError.size()) {
+        return this->fail(m_writeError);
+    }
+    auto res = m_batch.finish();
+    if (!res) {
+        return this->fail(res.error());
+    }
+    return Ok();
+}
+
+#endif
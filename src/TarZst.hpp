@@ -0,0 +1,108 @@
+#pragma once
+
+#ifdef GEODE_HAS_ZSTD
+
+#include "legacy/filesystem.hpp"
+#include "include/Result.hpp"
+#include "FileWriter.hpp"
+#include "CancelToken.hpp"
+#include <vector>
+#include <memory>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+struct ZSTD_DCtx_s;
+
+/**
+ * Extracts a zstd-compressed tar archive as
+ * its bytes arrive. Decompressing a zstd
+ * stream is inherently sequential, so instead
+ * the files are written on a separate thread
+ * while the next part of the archive is being
+ * decompressed, which keeps the decoder from
+ * ever waiting on the disk
+ */
+class TarZstExtractor {
+protected:
+    enum class State {
+        Header,
+        LongName,
+        PaxHeader,
+        Data,
+        Skip,
+        End,
+        Failed,
+    };
+
+    struct WriteJob {
+        enum class Type {
+            Open,
+            Data,
+            Close,
+        };
+        Type m_type;
+        ghc::filesystem::path m_path;
+        uint64_t m_size = 0;
+        uint32_t m_mode = 0;
+        std::vector<uint8_t> m_data;
+    };
+
+    ghc::filesystem::path m_target;
+    ZSTD_DCtx_s* m_stream = nullptr;
+    std::vector<uint8_t> m_output;
+    bool m_frameDone = false;
+
+    State m_state = State::Header;
+    std::vector<uint8_t> m_buffer;
+    size_t m_need = 512;
+    uint64_t m_remaining = 0;
+    uint64_t m_padding = 0;
+    std::string m_nextName;
+    std::string m_error;
+
+    std::thread m_writer;
+    std::mutex m_lock;
+    std::condition_variable m_jobAdded;
+    std::condition_variable m_jobDone;
+    std::deque<WriteJob> m_jobs;
+    size_t m_queuedBytes = 0;
+    bool m_closing = false;
+    std::string m_writeError;
+    FileWriteBatch m_batch;
+    std::shared_ptr<CancelToken> m_cancelToken;
+
+    bool fill(uint8_t const*& data, size_t& size);
+    Result<> process(uint8_t const* data, size_t size);
+    Result<> parseHeader();
+    void parsePaxHeader();
+    Result<> queue(WriteJob&& job);
+    void runWriter();
+    void stopWriter();
+    Err<> fail(std::string const& error);
+
+public:
+    /**
+     * If sync is set, the files are flushed
+     * to disk before finish() returns. Once the
+     * token is cancelled, writes fail and the
+     * writer drops whatever is still queued
+     */
+    TarZstExtractor(
+        ghc::filesystem::path const& target,
+        bool sync = false,
+        std::shared_ptr<CancelToken> const& cancelToken = nullptr
+    );
+    ~TarZstExtractor();
+
+    TarZstExtractor(TarZstExtractor const&) = delete;
+    TarZstExtractor& operator=(TarZstExtractor const&) = delete;
+
+    Result<> write(void const* data, size_t size);
+    Result<> finish();
+};
+
+#endif
@@ -0,0 +1,897 @@
+#include "Zip.hpp"
+#include "JobScheduler.hpp"
+#include "CancelToken.hpp"
+#include "include/json.hpp"
+#include <unordered_map>
+#include <set>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+#define ZIP_LOCAL_HEADER_SIG 0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG 0x02014b50
+#define ZIP_DESCRIPTOR_SIG 0x08074b50
+#define ZIP_END_SIG 0x06054b50
+#define ZIP64_END_SIG 0x06064b50
+#define ZIP64_LOCATOR_SIG 0x07064b50
+#define ZIP64_EXTRA_ID 0x0001
+
+#define ZIP_FLAG_DESCRIPTOR 0x8
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+
+#define ZIP_LOCAL_HEADER_SIZE 30
+#define ZIP_CENTRAL_HEADER_SIZE 46
+#define ZIP_END_SIZE 22
+
+#define INFLATE_CHUNK_SIZE (256 * 1024)
+
+static uint16_t read16(uint8_t const* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t read32(uint8_t const* p) {
+    return
+        static_cast<uint32_t>(p[0]) |
+        (static_cast<uint32_t>(p[1]) << 8) |
+        (static_cast<uint32_t>(p[2]) << 16) |
+        (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint64_t read64(uint8_t const* p) {
+    return read32(p) | (static_cast<uint64_t>(read32(p + 4)) << 32);
+}
+
+// fills in the sizes and offset that didn't fit
+// in 32 bits from the zip64 extended information
+static void readZip64Extra(
+    uint8_t const* extra, size_t size,
+    uint64_t* uncompressedSize,
+    uint64_t* compressedSize,
+    uint64_t* localHeaderOffset
+) {
+    while (size >= 4) {
+        auto id = read16(extra);
+        auto len = read16(extra + 2);
+        if (len + 4u > size) return;
+        if (id == ZIP64_EXTRA_ID) {
+            auto p = extra + 4;
+            auto end = p + len;
+            for (auto field : { uncompressedSize, compressedSize, localHeaderOffset }) {
+                if (field && *field == 0xffffffff && p + 8 <= end) {
+                    *field = read64(p);
+                    p += 8;
+                }
+            }
+            return;
+        }
+        extra += len + 4;
+        size -= len + 4;
+    }
+}
+
+bool ZipEntry::isDirectory() const {
+    return m_name.size() && m_name.back() == '/';
+}
+
+bool isSafeZipPath(std::string const& name) {
+    if (name.empty() || name.front() == '/' || name.front() == '\\') {
+        return false;
+    }
+    if (name.find(':') != std::string::npos) {
+        return false;
+    }
+    size_t start = 0;
+    while (start <= name.size()) {
+        auto end = name.find_first_of("/\\", start);
+        if (end == std::string::npos) end = name.size();
+        if (name.compare(start, end - start, "..") == 0 && end - start == 2) {
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+Result<std::vector<ZipEntry>> parseZipCentralDirectory(
+    uint8_t const* data,
+    size_t size
+) {
+    std::vector<ZipEntry> entries;
+    size_t offset = 0;
+    while (offset + 4 <= size && read32(data + offset) == ZIP_CENTRAL_HEADER_SIG) {
+        if (offset + ZIP_CENTRAL_HEADER_SIZE > size) {
+            return Err("Zip central directory is truncated");
+        }
+        auto p = data + offset;
+        auto nameLen = read16(p + 28);
+        auto extraLen = read16(p + 30);
+        auto commentLen = read16(p + 32);
+        auto recordSize = ZIP_CENTRAL_HEADER_SIZE + nameLen + extraLen + commentLen;
+        if (offset + recordSize > size) {
+            return Err("Zip central directory is truncated");
+        }
+
+        ZipEntry entry;
+        entry.m_method = read16(p + 10);
+        entry.m_crc32 = read32(p + 16);
+        entry.m_compressedSize = read32(p + 20);
+        entry.m_uncompressedSize = read32(p + 24);
+        entry.m_localHeaderOffset = read32(p + 42);
+        entry.m_name.assign(
+            reinterpret_cast<char const*>(p + ZIP_CENTRAL_HEADER_SIZE), nameLen
+        );
+        readZip64Extra(
+            p + ZIP_CENTRAL_HEADER_SIZE + nameLen, extraLen,
+            &entry.m_uncompressedSize,
+            &entry.m_compressedSize,
+            &entry.m_localHeaderOffset
+        );
+        // made by unix, permissions are in the
+        // upper half of the external attributes
+        if ((read16(p + 4) >> 8) == 3) {
+            entry.m_mode = (read32(p + 38) >> 16) & 0777;
+        }
+        entries.push_back(entry);
+        offset += recordSize;
+    }
+
+    uint64_t total = 0;
+    if (offset + 4 <= size && read32(data + offset) == ZIP64_END_SIG) {
+        if (offset + 56 > size) {
+            return Err("Zip64 end of central directory is truncated");
+        }
+        total = read64(data + offset + 32);
+        offset += 12 + read64(data + offset + 4);
+        if (offset + 20 <= size && read32(data + offset) == ZIP64_LOCATOR_SIG) {
+            offset += 20;
+        }
+    }
+    if (offset + ZIP_END_SIZE > size || read32(data + offset) != ZIP_END_SIG) {
+        return Err("Zip end of central directory not found");
+    }
+    if (read16(data + offset + 10) != 0xffff) {
+        total = read16(data + offset + 10);
+    }
+    if (total != entries.size()) {
+        return Err("Zip central directory has the wrong amount of entries");
+    }
+    return Ok(entries);
+}
+
+ZipStreamExtractor::ZipStreamExtractor(ghc::filesystem::path const& target, bool sync)
+  : m_target(target), m_batch(sync) {
+    m_inflate = z_stream();
+}
+
+ZipStreamExtractor::~ZipStreamExtractor() {
+    if (m_inflating) {
+        inflateEnd(&m_inflate);
+    }
+}
+
+Err<> ZipStreamExtractor::fail(std::string const& error) {
+    m_state = State::Failed;
+    m_error = error;
+    // nothing written is kept, but the files 
+    // have to be closed for it to be removed
+    if (m_writing) {
+        m_writing = false;
+        m_out.finish();
+    }
+    m_batch.finish();
+    return Err(error);
+}
+
+bool ZipStreamExtractor::fill(uint8_t const*& data, size_t& size) {
+    auto take = std::min(m_need - m_buffer.size(), size);
+    m_buffer.insert(m_buffer.end(), data, data + take);
+    data += take;
+    size -= take;
+    return m_buffer.size() == m_need;
+}
+
+Result<> ZipStreamExtractor::write(void const* rawData, size_t size) {
+    auto data = static_cast<uint8_t const*>(rawData);
+    while (size) {
+        switch (m_state) {
+            case State::Signature: {
+                if (!this->fill(data, size)) break;
+                auto sig = read32(m_buffer.data());
+                if (sig == ZIP_LOCAL_HEADER_SIG) {
+                    m_state = State::LocalHeader;
+                    m_need = ZIP_LOCAL_HEADER_SIZE;
+                } else if (sig == ZIP_CENTRAL_HEADER_SIG || sig == ZIP_END_SIG) {
+                    m_state = State::CentralDirectory;
+                    m_centralDirectory = std::move(m_buffer);
+                    m_buffer.clear();
+                } else {
+                    return this->fail("Unexpected data in zip");
+                }
+            } break;
+
+            case State::LocalHeader: {
+                if (!this->fill(data, size)) break;
+                m_state = State::LocalName;
+                m_need = ZIP_LOCAL_HEADER_SIZE +
+                    read16(m_buffer.data() + 26) + read16(m_buffer.data() + 28);
+            } break;
+
+            case State::LocalName: {
+                if (!this->fill(data, size)) break;
+                auto res = this->parseLocalHeader();
+                if (!res) return res;
+            } break;
+
+            case State::Data: {
+                if (m_inflating) {
+                    auto res = this->inflateData(data, size);
+                    if (!res) return res;
+                } else {
+                    auto take = static_cast<size_t>(std::min<uint64_t>(m_remaining, size));
+                    auto res = this->writeData(data, take);
+                    if (!res) return res;
+                    data += take;
+                    size -= take;
+                    m_remaining -= take;
+                    if (!m_remaining) {
+                        auto res = this->endEntry();
+                        if (!res) return res;
+                    }
+                }
+            } break;
+
+            case State::Descriptor: {
+                if (!this->fill(data, size)) break;
+                // the signature of the data descriptor is
+                // optional, so we only know its size after
+                // reading the first four bytes
+                if (m_need == 4) {
+                    auto sizes = m_zip64 ? 16u : 8u;
+                    m_need = read32(m_buffer.data()) == ZIP_DESCRIPTOR_SIG ?
+                        8 + sizes : 4 + sizes;
+                    break;
+                }
+                auto res = this->parseDescriptor();
+                if (!res) return res;
+            } break;
+
+            case State::CentralDirectory: {
+                m_centralDirectory.insert(m_centralDirectory.end(), data, data + size);
+                size = 0;
+            } break;
+
+            case State::Failed: {
+                return Err(m_error);
+            } break;
+        }
+    }
+    return Ok();
+}
+
+Result<> ZipStreamExtractor::parseLocalHeader() {
+    auto p = m_buffer.data();
+    auto nameLen = read16(p + 26);
+    auto extraLen = read16(p + 28);
+
+    m_current = ZipEntry();
+    m_flags = read16(p + 6);
+    m_current.m_method = read16(p + 8);
+    m_current.m_crc32 = read32(p + 14);
+    m_current.m_compressedSize = read32(p + 18);
+    m_current.m_uncompressedSize = read32(p + 22);
+    m_current.m_name.assign(
+        reinterpret_cast<char const*>(p + ZIP_LOCAL_HEADER_SIZE), nameLen
+    );
+    m_zip64 =
+        m_current.m_compressedSize == 0xffffffff ||
+        m_current.m_uncompressedSize == 0xffffffff;
+    readZip64Extra(
+        p + ZIP_LOCAL_HEADER_SIZE + nameLen, extraLen,
+        &m_current.m_uncompressedSize,
+        &m_current.m_compressedSize,
+        nullptr
+    );
+    m_buffer.clear();
+    return this->beginEntry();
+}
+
+Result<> ZipStreamExtractor::beginEntry() {
+    if (!isSafeZipPath(m_current.m_name)) {
+        return this->fail("Zip entry \"" + m_current.m_name + "\" points outside the target");
+    }
+    auto path = m_target / ghc::filesystem::u8path(m_current.m_name);
+    m_crc = crc32(0, nullptr, 0);
+    m_written = 0;
+    try {
+        if (m_current.isDirectory()) {
+            ghc::filesystem::create_directories(path);
+        } else {
+            ghc::filesystem::create_directories(path.parent_path());
+        }
+    } catch(std::exception& e) {
+        return this->fail(e.what());
+    }
+
+    if (!m_current.isDirectory()) {
+        // the file may be a hardlink to a file in use, 
+        // so replace it instead of writing through it
+        std::error_code ec;
+        ghc::filesystem::remove(path, ec);
+        // the size is only known up front if the 
+        // entry has no data descriptor
+        auto res = m_out.open(path, m_current.m_uncompressedSize);
+        if (!res) {
+            return this->fail(res.error());
+        }
+        m_writing = true;
+    }
+
+    switch (m_current.m_method) {
+        case ZIP_METHOD_STORED: {
+            // without the size in the header there's no
+            // way of knowing where stored data ends
+            if (m_flags & ZIP_FLAG_DESCRIPTOR) {
+                return this->fail(
+                    "Zip entry \"" + m_current.m_name + "\" can't be streamed"
+                );
+            }
+            m_remaining = m_current.m_compressedSize;
+            m_state = State::Data;
+            if (!m_remaining) {
+                return this->endEntry();
+            }
+        } break;
+
+        case ZIP_METHOD_DEFLATED: {
+            m_inflate = z_stream();
+            if (inflateInit2(&m_inflate, -MAX_WBITS) != Z_OK) {
+                return this->fail("Unable to initialize zlib");
+            }
+            m_inflating = true;
+            m_inflateBuffer.resize(INFLATE_CHUNK_SIZE);
+            m_state = State::Data;
+        } break;
+
+        default: {
+            return this->fail(
+                "Zip entry \"" + m_current.m_name + "\" uses an "
+                "unsupported compression method"
+            );
+        } break;
+    }
+    return Ok();
+}
+
+Result<> ZipStreamExtractor::writeData(uint8_t const* data, size_t size) {
+    if (!size) return Ok();
+    m_crc = crc32(m_crc, data, static_cast<uInt>(size));
+    m_written += size;
+    if (m_writing) {
+        auto res = m_out.write(data, size);
+        if (!res) {
+            return this->fail(res.error());
+        }
+    }
+    return Ok();
+}
+
+Result<> ZipStreamExtractor::inflateData(uint8_t const*& data, size_t& size) {
+    m_inflate.next_in = const_cast<Bytef*>(data);
+    m_inflate.avail_in = static_cast<uInt>(size);
+    int ret = Z_OK;
+    while (m_inflate.avail_in && ret != Z_STREAM_END) {
+        m_inflate.next_out = m_inflateBuffer.data();
+        m_inflate.avail_out = static_cast<uInt>(m_inflateBuffer.size());
+        ret = inflate(&m_inflate, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            return this->fail("Zip entry \"" + m_current.m_name + "\" is corrupted");
+        }
+        auto res = this->writeData(
+            m_inflateBuffer.data(), m_inflateBuffer.size() - m_inflate.avail_out
+        );
+        if (!res) return res;
+    }
+    auto consumed = size - m_inflate.avail_in;
+    data += consumed;
+    size -= consumed;
+    if (ret == Z_STREAM_END) {
+        inflateEnd(&m_inflate);
+        m_inflating = false;
+        return this->endEntry();
+    }
+    return Ok();
+}
+
+Result<> ZipStreamExtractor::endEntry() {
+    if (m_writing) {
+        m_writing = false;
+        auto res = m_out.finish(&m_batch);
+        if (!res) {
+            return this->fail(res.error());
+        }
+    }
+    if (m_flags & ZIP_FLAG_DESCRIPTOR) {
+        m_state = State::Descriptor;
+        m_need = 4;
+        return Ok();
+    }
+    if (m_crc != m_current.m_crc32 || m_written != m_current.m_uncompressedSize) {
+        return this->fail("Zip entry \"" + m_current.m_name + "\" failed CRC check");
+    }
+    m_extracted.push_back(m_current);
+    m_state = State::Signature;
+    m_need = 4;
+    return Ok();
+}
+
+Result<> ZipStreamExtractor::parseDescriptor() {
+    auto p = m_buffer.data();
+    if (read32(p) == ZIP_DESCRIPTOR_SIG) {
+        p += 4;
+    }
+    m_current.m_crc32 = read32(p);
+    if (m_zip64) {
+        m_current.m_compressedSize = read64(p + 4);
+        m_current.m_uncompressedSize = read64(p + 12);
+    } else {
+        m_current.m_compressedSize = read32(p + 4);
+        m_current.m_uncompressedSize = read32(p + 8);
+    }
+    m_buffer.clear();
+    if (m_crc != m_current.m_crc32 || m_written != m_current.m_uncompressedSize) {
+        return this->fail("Zip entry \"" + m_current.m_name + "\" failed CRC check");
+    }
+    m_extracted.push_back(m_current);
+    m_state = State::Signature;
+    m_need = 4;
+    return Ok();
+}
+
+Result<std::vector<ZipEntry>> ZipStreamExtractor::finish() {
+    if (m_state == State::Failed) {
+        return Err(m_error);
+    }
+    if (m_state != State::CentralDirectory) {
+        return this->fail("Zip ended unexpectedly");
+    }
+    auto central = parseZipCentralDirectory(
+        m_centralDirectory.data(), m_centralDirectory.size()
+    );
+    if (!central) {
+        return this->fail(central.error());
+    }
+    auto entries = central.value();
+    if (entries.size() != m_extracted.size()) {
+        return this->fail("Zip central directory doesn't match its contents");
+    }
+    std::unordered_map<std::string, ZipEntry const*> extracted;
+    for (auto& entry : m_extracted) {
+        extracted.insert({ entry.m_name, &entry });
+    }
+    for (auto& entry : entries) {
+        auto it = extracted.find(entry.m_name);
+        if (
+            it == extracted.end() ||
+            it->second->m_crc32 != entry.m_crc32 ||
+            it->second->m_uncompressedSize != entry.m_uncompressedSize
+        ) {
+            return this->fail(
+                "Zip entry \"" + entry.m_name + "\" doesn't match the central directory"
+            );
+        }
+        #ifndef _WIN32
+        if (entry.m_mode && !entry.isDirectory()) {
+            std::error_code ec;
+            ghc::filesystem::permissions(
+                m_target / ghc::filesystem::u8path(entry.m_name),
+                static_cast<ghc::filesystem::perms>(entry.m_mode),
+                ec
+            );
+        }
+        #endif
+    }
+    auto res = m_batch.finish();
+    if (!res) {
+        return this->fail(res.error());
+    }
+    return Ok(entries);
+}
+
+static int64_t getModifiedTime(ghc::filesystem::path const& file, std::error_code& ec) {
+    return static_cast<int64_t>(
+        ghc::filesystem::last_write_time(file, ec).time_since_epoch().count()
+    );
+}
+
+ZipCrcCache::ZipCrcCache(ghc::filesystem::path const& path) : m_path(path) {
+    try {
+        std::ifstream ifs(path);
+        if (!ifs.is_open()) return;
+        auto json = nlohmann::json::parse(ifs);
+        for (auto& [file, entry] : json.items()) {
+            m_entries.insert({ file, {
+                entry["size"].get<uint64_t>(),
+                entry["modified"].get<int64_t>(),
+                entry["crc32"].get<uint32_t>(),
+            } });
+        }
+    } catch(std::exception&) {
+        // the cache is only an optimization
+        m_entries.clear();
+    }
+}
+
+tl::optional<uint32_t> ZipCrcCache::getCrc(ghc::filesystem::path const& file) {
+    std::error_code ec;
+    auto size = ghc::filesystem::file_size(file, ec);
+    if (ec) return tl::nullopt;
+    auto modified = getModifiedTime(file, ec);
+    if (ec) return tl::nullopt;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto it = m_entries.find(file.string());
+        if (
+            it != m_entries.end() &&
+            it->second.m_size == size &&
+            it->second.m_modified == modified
+        ) {
+            return it->second.m_crc32;
+        }
+    }
+
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs.is_open()) return tl::nullopt;
+    std::vector<char> buffer(INFLATE_CHUNK_SIZE);
+    auto crc = crc32(0, nullptr, 0);
+    while (ifs) {
+        ifs.read(buffer.data(), buffer.size());
+        crc = crc32(
+            crc, reinterpret_cast<Bytef const*>(buffer.data()),
+            static_cast<uInt>(ifs.gcount())
+        );
+    }
+    if (!ifs.eof()) return tl::nullopt;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_entries[file.string()] = { size, modified, static_cast<uint32_t>(crc) };
+    return static_cast<uint32_t>(crc);
+}
+
+void ZipCrcCache::update(ghc::filesystem::path const& file, uint32_t crc) {
+    std::error_code ec;
+    auto size = ghc::filesystem::file_size(file, ec);
+    if (ec) return;
+    auto modified = getModifiedTime(file, ec);
+    if (ec) return;
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_entries[file.string()] = { size, modified, crc };
+}
+
+Result<> ZipCrcCache::save() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto json = nlohmann::json::object();
+    for (auto& [file, entry] : m_entries) {
+        json[file] = {
+            { "size", entry.m_size },
+            { "modified", entry.m_modified },
+            { "crc32", entry.m_crc32 },
+        };
+    }
+    try {
+        ghc::filesystem::create_directories(m_path.parent_path());
+    } catch(std::exception&) {}
+    std::ofstream ofs(m_path);
+    if (!ofs.is_open()) {
+        return Err("Unable to write \"" + m_path.string() + "\"");
+    }
+    ofs << json.dump();
+    return Ok();
+}
+
+Result<ZipArchive> ZipArchive::open(ghc::filesystem::path const& path) {
+    auto mapped = MappedFile::open(path);
+    if (!mapped) {
+        return Err(mapped.error());
+    }
+    auto file = mapped.value();
+    auto data = file->getData();
+    uint64_t fileSize = file->getSize();
+    if (fileSize < ZIP_END_SIZE) {
+        return Err("Zip end of central directory not found");
+    }
+
+    // the end of central directory record is followed 
+    // by a comment of at most 64K, so look for its 
+    // signature from the back of that range
+    uint64_t endOffset = fileSize;
+    uint64_t searchEnd = fileSize - std::min<uint64_t>(fileSize, ZIP_END_SIZE + 0xffff);
+    for (uint64_t i = fileSize - ZIP_END_SIZE + 1; i-- > searchEnd;) {
+        if (read32(data + i) == ZIP_END_SIG) {
+            endOffset = i;
+            break;
+        }
+    }
+    if (endOffset == fileSize) {
+        return Err("Zip end of central directory not found");
+    }
+    uint64_t centralOffset = read32(data + endOffset + 16);
+
+    if (centralOffset == 0xffffffff) {
+        if (
+            endOffset < 20 ||
+            read32(data + endOffset - 20) != ZIP64_LOCATOR_SIG
+        ) {
+            return Err("Zip64 end of central directory not found");
+        }
+        auto zip64End = read64(data + endOffset - 20 + 8);
+        if (zip64End + 56 > endOffset || read32(data + zip64End) != ZIP64_END_SIG) {
+            return Err("Zip64 end of central directory not found");
+        }
+        centralOffset = read64(data + zip64End + 48);
+    }
+    if (centralOffset > endOffset) {
+        return Err("Zip central directory is out of bounds");
+    }
+
+    // the central directory is parsed right 
+    // where it is in the mapping
+    auto entries = parseZipCentralDirectory(
+        data + centralOffset,
+        static_cast<size_t>(fileSize - centralOffset)
+    );
+    if (!entries) {
+        return Err(entries.error());
+    }
+    for (auto& entry : entries.value()) {
+        if (!isSafeZipPath(entry.m_name)) {
+            return Err("Zip entry \"" + entry.m_name + "\" points outside the target");
+        }
+    }
+
+    ZipArchive archive;
+    archive.m_path = path;
+    archive.m_file = file;
+    archive.m_entries = entries.value();
+    return Ok(archive);
+}
+
+ghc::filesystem::path const& ZipArchive::getPath() const {
+    return m_path;
+}
+
+std::vector<ZipEntry> const& ZipArchive::getEntries() const {
+    return m_entries;
+}
+
+Result<> ZipArchive::extractEntry(
+    ZipEntry const& entry,
+    ghc::filesystem::path const& target,
+    FileWriteBatch* batch
+) const {
+    auto data = m_file->getData();
+    uint64_t fileSize = m_file->getSize();
+    auto header = entry.m_localHeaderOffset;
+    if (
+        header + ZIP_LOCAL_HEADER_SIZE > fileSize ||
+        read32(data + header) != ZIP_LOCAL_HEADER_SIG
+    ) {
+        return Err("Zip entry \"" + entry.m_name + "\" has no local header");
+    }
+    auto start = header + ZIP_LOCAL_HEADER_SIZE +
+        read16(data + header + 26) + read16(data + header + 28);
+    if (start + entry.m_compressedSize > fileSize) {
+        return Err("Zip entry \"" + entry.m_name + "\" is truncated");
+    }
+    auto compressed = data + start;
+
+    auto path = target / ghc::filesystem::u8path(entry.m_name);
+    // the file may be a hardlink to a file in use, 
+    // so replace it instead of writing through it
+    std::error_code ec;
+    ghc::filesystem::remove(path, ec);
+    FileWriter out;
+    auto opened = out.open(path, entry.m_uncompressedSize);
+    if (!opened) {
+        return opened;
+    }
+
+    auto crc = crc32(0, nullptr, 0);
+    uint64_t written = 0;
+    auto write = [&](uint8_t const* data, uint64_t size) -> bool {
+        while (size) {
+            // zlib takes 32-bit sizes
+            auto take = static_cast<uInt>(std::min<uint64_t>(size, INFLATE_CHUNK_SIZE));
+            crc = crc32(crc, data, take);
+            if (!out.write(data, take)) return false;
+            written += take;
+            data += take;
+            size -= take;
+        }
+        return true;
+    };
+
+    switch (entry.m_method) {
+        case ZIP_METHOD_STORED: {
+            // straight from the mapping into the file
+            if (!write(compressed, entry.m_compressedSize)) {
+                return Err("Unable to write \"" + path.string() + "\"");
+            }
+        } break;
+
+        case ZIP_METHOD_DEFLATED: {
+            z_stream stream = z_stream();
+            if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+                return Err("Unable to initialize zlib");
+            }
+            std::vector<uint8_t> buffer(INFLATE_CHUNK_SIZE);
+            auto remaining = entry.m_compressedSize;
+            int ret = Z_OK;
+            while (ret != Z_STREAM_END) {
+                if (!stream.avail_in) {
+                    if (!remaining) {
+                        inflateEnd(&stream);
+                        return Err("Zip entry \"" + entry.m_name + "\" is truncated");
+                    }
+                    auto take = std::min<uint64_t>(remaining, 0x40000000);
+                    stream.next_in = const_cast<Bytef*>(
+                        compressed + (entry.m_compressedSize - remaining)
+                    );
+                    stream.avail_in = static_cast<uInt>(take);
+                    remaining -= take;
+                }
+                stream.next_out = buffer.data();
+                stream.avail_out = static_cast<uInt>(buffer.size());
+                ret = inflate(&stream, Z_NO_FLUSH);
+                if (ret != Z_OK && ret != Z_STREAM_END) {
+                    inflateEnd(&stream);
+                    return Err("Zip entry \"" + entry.m_name + "\" is corrupted");
+                }
+                if (!write(buffer.data(), buffer.size() - stream.avail_out)) {
+                    inflateEnd(&stream);
+                    return Err("Unable to write \"" + path.string() + "\"");
+                }
+            }
+            inflateEnd(&stream);
+        } break;
+
+        default: {
+            return Err(
+                "Zip entry \"" + entry.m_name + "\" uses an "
+                "unsupported compression method"
+            );
+        } break;
+    }
+
+    auto finished = out.finish(batch);
+    if (!finished) {
+        return finished;
+    }
+    if (crc != entry.m_crc32 || written != entry.m_uncompressedSize) {
+        return Err("Zip entry \"" + entry.m_name + "\" failed CRC check");
+    }
+    #ifndef _WIN32
+    if (entry.m_mode) {
+        std::error_code ec;
+        ghc::filesystem::permissions(
+            path, static_cast<ghc::filesystem::perms>(entry.m_mode), ec
+        );
+    }
+    #endif
+    return Ok();
+}
+
+Result<> ZipArchive::extractTo(
+    ghc::filesystem::path const& target,
+    size_t threads,
+    ZipCrcCache* crcCache,
+    bool sync,
+    JobScheduler* scheduler,
+    std::shared_ptr<CancelToken> const& cancelToken
+) const {
+    std::set<ghc::filesystem::path> directories;
+    std::vector<ZipEntry const*> files;
+    for (auto& entry : m_entries) {
+        auto path = target / ghc::filesystem::u8path(entry.m_name);
+        if (entry.isDirectory()) {
+            directories.insert(path);
+        } else {
+            directories.insert(path.parent_path());
+            files.push_back(&entry);
+        }
+    }
+    try {
+        for (auto& dir : directories) {
+            ghc::filesystem::create_directories(dir);
+        }
+    } catch(std::exception& e) {
+        return Err(e.what());
+    }
+
+    // start with the biggest files so one of them 
+    // isn't left running alone at the end
+    std::sort(files.begin(), files.end(), [](ZipEntry const* a, ZipEntry const* b) {
+        return a->m_compressedSize > b->m_compressedSize;
+    });
+
+    if (!threads) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, files.size());
+
+    FileWriteBatch batch(sync);
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::mutex lock;
+    std::string error;
+    std::vector<std::pair<ghc::filesystem::path, uint32_t>> extracted;
+    auto extractFile = [&](size_t ix) -> void {
+        if (failed) return;
+        if (cancelToken && cancelToken->isCancelled()) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!failed.exchange(true)) {
+                error = "Cancelled";
+            }
+            return;
+        }
+        auto& entry = *files[ix];
+        auto path = target / ghc::filesystem::u8path(entry.m_name);
+        // leave files that are already up-to-date alone; 
+        // the size check is free and rules out most 
+        // changed files without reading them
+        if (crcCache) {
+            std::error_code ec;
+            auto size = ghc::filesystem::file_size(path, ec);
+            if (!ec && size == entry.m_uncompressedSize) {
+                auto crc = crcCache->getCrc(path);
+                if (crc && crc.value() == entry.m_crc32) {
+                    return;
+                }
+            }
+        }
+        auto res = this->extractEntry(entry, target, &batch);
+        std::lock_guard<std::mutex> guard(lock);
+        if (res) {
+            extracted.push_back({ path, entry.m_crc32 });
+        } else if (!failed.exchange(true)) {
+            error = res.error();
+        }
+    };
+
+    if (scheduler) {
+        scheduler->parallelFor(files.size(), extractFile);
+    } else {
+        auto work = [&]() -> void {
+            while (!failed) {
+                auto ix = next++;
+                if (ix >= files.size()) break;
+                extractFile(ix);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < threads; i++) {
+            workers.emplace_back(work);
+        }
+        // the calling thread pulls its weight too
+        work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    auto closed = batch.finish();
+    if (failed) {
+        return Err(error);
+    }
+    if (!closed) {
+        return closed;
+    }
+    // Windows may only update the modification 
+    // time once the file is closed
+    if (crcCache) {
+        for (auto& [path, crc] : extracted) {
+            crcCache->update(path, crc);
+        }
+    }
+    return Ok();
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "legacy/filesystem.hpp"
+#include "include/Result.hpp"
+#include "legacy/optional.hpp"
+#include "MappedFile.hpp"
+#include "FileWriter.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <zlib.h>
+
+class JobScheduler;
+class CancelToken;
+
+/**
+ * An entry of a zip archive, as described
+ * by its central directory record
+ */
+struct ZipEntry {
+    std::string m_name;
+    uint16_t m_method = 0;
+    uint32_t m_crc32 = 0;
+    uint64_t m_compressedSize = 0;
+    uint64_t m_uncompressedSize = 0;
+    uint64_t m_localHeaderOffset = 0;
+    /**
+     * Unix permission bits, or 0 if the
+     * archive wasn't made on a unix system
+     */
+    uint32_t m_mode = 0;
+
+    bool isDirectory() const;
+};
+
+/**
+ * Parse the central directory records starting
+ * at data, followed by the end of central
+ * directory record
+ */
+Result<std::vector<ZipEntry>> parseZipCentralDirectory(
+    uint8_t const* data,
+    size_t size
+);
+
+/**
+ * Whether the entry name stays inside the
+ * directory it's extracted to
+ */
+bool isSafeZipPath(std::string const& name);
+
+/**
+ * Extracts a zip archive as its bytes arrive,
+ * using the local file headers to find the
+ * entries. Once the whole archive has been
+ * written, finish() checks the extracted
+ * entries against the central directory
+ */
+class ZipStreamExtractor {
+protected:
+    enum class State {
+        Signature,
+        LocalHeader,
+        LocalName,
+        Data,
+        Descriptor,
+        CentralDirectory,
+        Failed,
+    };
+
+    ghc::filesystem::path m_target;
+    State m_state = State::Signature;
+    std::vector<uint8_t> m_buffer;
+    size_t m_need = 4;
+    std::vector<uint8_t> m_centralDirectory;
+
+    ZipEntry m_current;
+    uint16_t m_flags = 0;
+    bool m_zip64 = false;
+    uint64_t m_remaining = 0;
+    uint32_t m_crc = 0;
+    uint64_t m_written = 0;
+    z_stream m_inflate;
+    bool m_inflating = false;
+    std::vector<uint8_t> m_inflateBuffer;
+    FileWriter m_out;
+    bool m_writing = false;
+    FileWriteBatch m_batch;
+    std::vector<ZipEntry> m_extracted;
+    std::string m_error;
+
+    bool fill(uint8_t const*& data, size_t& size);
+    Result<> parseLocalHeader();
+    Result<> beginEntry();
+    Result<> writeData(uint8_t const* data, size_t size);
+    Result<> inflateData(uint8_t const*& data, size_t& size);
+    Result<> endEntry();
+    Result<> parseDescriptor();
+    Err<> fail(std::string const& error);
+
+public:
+    /**
+     * If sync is set, the files are flushed
+     * to disk before finish() returns
+     */
+    ZipStreamExtractor(ghc::filesystem::path const& target, bool sync = false);
+    ~ZipStreamExtractor();
+
+    ZipStreamExtractor(ZipStreamExtractor const&) = delete;
+    ZipStreamExtractor& operator=(ZipStreamExtractor const&) = delete;
+
+    Result<> write(void const* data, size_t size);
+    Result<std::vector<ZipEntry>> finish();
+};
+
+/**
+ * Remembers the CRC-32 of files extracted 
+ * earlier along with the size and modification 
+ * time they had then, so a file that hasn't 
+ * been touched since doesn't need to be read 
+ * to know whether it matches a zip entry. 
+ * Thread-safe
+ */
+class ZipCrcCache {
+protected:
+    struct Entry {
+        uint64_t m_size;
+        int64_t m_modified;
+        uint32_t m_crc32;
+    };
+
+    ghc::filesystem::path m_path;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::mutex m_lock;
+
+public:
+    ZipCrcCache(ghc::filesystem::path const& path);
+
+    /**
+     * Get the CRC-32 of a file, from the cache 
+     * if it hasn't changed or by reading it 
+     * otherwise
+     */
+    tl::optional<uint32_t> getCrc(ghc::filesystem::path const& file);
+    void update(ghc::filesystem::path const& file, uint32_t crc);
+    Result<> save();
+};
+
+/**
+ * A zip archive on disk, mapped into memory 
+ * and read through its central directory. 
+ * Entries are located independently of each 
+ * other, so they can be extracted in parallel
+ */
+class ZipArchive {
+protected:
+    ghc::filesystem::path m_path;
+    std::shared_ptr<MappedFile> m_file;
+    std::vector<ZipEntry> m_entries;
+
+public:
+    static Result<ZipArchive> open(ghc::filesystem::path const& path);
+
+    ghc::filesystem::path const& getPath() const;
+    std::vector<ZipEntry> const& getEntries() const;
+
+    /**
+     * Extract a single file entry into the target 
+     * directory, whose parent directories must 
+     * already exist. Safe to call from multiple 
+     * threads at once. If a batch is given, 
+     * closing the file is left to it
+     */
+    Result<> extractEntry(
+        ZipEntry const& entry,
+        ghc::filesystem::path const& target,
+        FileWriteBatch* batch = nullptr
+    ) const;
+    /**
+     * Extract the whole archive into the target 
+     * directory. Directories are created up front 
+     * and files are then inflated and written on 
+     * a pool of worker threads (0 = one per core). 
+     * If a CRC cache is given, files that already 
+     * exist with the same size and CRC-32 as their 
+     * entry are left alone. Files are closed in 
+     * one batch at the end, and if sync is set, 
+     * flushed to disk before that. If a scheduler 
+     * is given, files are extracted on its workers 
+     * instead and threads is ignored. Once the 
+     * token is cancelled, no more files are 
+     * started and the files already written are 
+     * left for the caller to clean up
+     */
+    Result<> extractTo(
+        ghc::filesystem::path const& target,
+        size_t threads = 0,
+        ZipCrcCache* crcCache = nullptr,
+        bool sync = false,
+        JobScheduler* scheduler = nullptr,
+        std::shared_ptr<CancelToken> const& cancelToken = nullptr
+    ) const;
+};
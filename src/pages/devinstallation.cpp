@@ -140,10 +140,10 @@ protected:
     wxGauge* m_gauge;
 
     void enter() override {
-        Manager::get()->downloadCLI(
+        Manager::get()->streamInstallCLI(
             [this](std::string const& str) -> void {
                 wxMessageBox(
-                    "Error downloading the Geode CLI: " + str + 
+                    "Error installing the Geode CLI: " + str + 
                     ". Try again, and if the problem persists, contact "
                     "the Geode Development team for more help.",
                     "Error Installing",
@@ -155,52 +155,39 @@ protected:
                 this->setText(m_status, "Downloading Geode CLI: " + text);
                 m_gauge->SetValue(prog);
             },
-            [this](wxWebResponse const& wres) -> void {
-                auto installRes = Manager::get()->installCLI(
-                    wres.GetDataFile().ToStdWstring()
-                );
-                if (!installRes) {
-                    wxMessageBox(
-                        "Error installing Geode CLI: " + installRes.error() + ". Try "
-                        "again, and if the problem persists, contact "
-                        "the Geode Development team for more help.",
-                        "Error Installing",
-                        wxICON_ERROR
-                    );
-                } else {
-                    auto res = Manager::get()->installSuite(
-                        GET_EARLIER_PAGE(DevInstallBranch)->getBranch(),
-                        [this](std::string const& err) -> void {
-                            wxMessageBox(
-                                "Error installing the Geode SDK: " + err + 
-                                ". Try again, and if the problem persists, contact "
-                                "the Geode Development team for more help.",
-                                "Error Installing",
-                                wxICON_ERROR
-                            );
-                            this->setText(m_status, "Error: " + err);
-                        },
-                        [this](std::string const& text, int prog) -> void {
-                            m_gauge->SetValue(prog);
-                            this->setText(m_status, "Installing SDK: " + text);
-                        },
-                        [this]() -> void {
-                            if (GET_EARLIER_PAGE(DevInstallAddToPath)->shouldAddToPath()) {
-                                auto res = Manager::get()->addCLIToPath();
-                                if (!res) {
-                                    wxMessageBox(
-                                        "Error adding Geode CLI to Path: " + res.error(),
-                                        "Error Installing",
-                                        wxICON_ERROR
-                                    );
-                                }
+            [this]() -> void {
+                auto res = Manager::get()->installSuite(
+                    GET_EARLIER_PAGE(DevInstallBranch)->getBranch(),
+                    [this](std::string const& err) -> void {
+                        wxMessageBox(
+                            "Error installing the Geode SDK: " + err + 
+                            ". Try again, and if the problem persists, contact "
+                            "the Geode Development team for more help.",
+                            "Error Installing",
+                            wxICON_ERROR
+                        );
+                        this->setText(m_status, "Error: " + err);
+                    },
+                    [this](std::string const& text, int prog) -> void {
+                        m_gauge->SetValue(prog);
+                        this->setText(m_status, "Installing SDK: " + text);
+                    },
+                    [this]() -> void {
+                        if (GET_EARLIER_PAGE(DevInstallAddToPath)->shouldAddToPath()) {
+                            auto res = Manager::get()->addCLIToPath();
+                            if (!res) {
+                                wxMessageBox(
+                                    "Error adding Geode CLI to Path: " + res.error(),
+                                    "Error Installing",
+                                    wxICON_ERROR
+                                );
                             }
-                            m_frame->nextPage();
                         }
-                    );
-                    if (!res) {
-                        wxMessageBox("Error installing SDK: " + res.error());
+                        m_frame->nextPage();
                     }
+                );
+                if (!res) {
+                    wxMessageBox("Error installing SDK: " + res.error());
                 }
             }
         );
@@ -26,6 +26,29 @@ public:
             wxLB_SINGLE | wxLB_HSCROLL
         )), 1, wxALL | wxEXPAND, 10);
         m_list->Bind(wxEVT_LISTBOX, &PageManageSelect::onSelect, this);
+
+        Manager::get()->checkAllForUpdates(
+            [this](UpdateCheckTable const& table) -> void {
+                this->markUpdates(table);
+            }
+        );
+    }
+
+    void markUpdates(UpdateCheckTable const& table) {
+        unsigned int ix = 0;
+        if (Manager::get()->isSuiteInstalled()) {
+            if (table.m_cli.isUpdateAvailable()) {
+                m_list->SetString(ix, m_list->GetString(ix) + " (update available)");
+            }
+            ix++;
+        }
+        for (auto& result : table.m_installations) {
+            if (ix >= m_list->GetCount()) break;
+            if (result.isUpdateAvailable()) {
+                m_list->SetString(ix, m_list->GetString(ix) + " (update available)");
+            }
+            ix++;
+        }
     }
 
     bool updateCLI() const {
@@ -51,10 +74,44 @@ class PageManageCheck : public Page {
 protected:
     wxStaticText* m_status;
     wxStaticText* m_nextInfo;
+    wxButton* m_rollback;
     VersionInfo m_newLoaderVersion;
     VersionInfo m_newCLIVersion;
 
+    void onRollback(wxCommandEvent&) {
+        auto res = Manager::get()->rollbackCLI();
+        if (!res) {
+            wxMessageBox(
+                "Error rolling back Geode CLI: " + res.error() + ". Try "
+                "again, and if the problem persists, contact "
+                "the Geode Development team for more help.",
+                "Error Rolling Back",
+                wxICON_ERROR
+            );
+            return;
+        }
+        m_rollback->Disable();
+        this->setText(
+            m_status,
+            "Rolled back to version " + Manager::get()->getCLIVersion().toString() + "."
+        );
+        this->setText(m_nextInfo, "");
+        m_canContinue = false;
+        m_frame->updateControls();
+    }
+
     void enter() override {
+        // the page is kept around, so whatever the last 
+        // visit left here may not apply anymore
+        this->setText(m_status, "Checking for updates...");
+        this->setText(m_nextInfo, "");
+        m_canContinue = false;
+        auto canRollback =
+            GET_EARLIER_PAGE(ManageSelect)->updateCLI() &&
+            Manager::get()->canRollbackCLI();
+        m_rollback->Show(canRollback);
+        m_rollback->Enable(canRollback);
+
         if (GET_EARLIER_PAGE(ManageSelect)->updateCLI()) {
             Manager::get()->checkCLIForUpdates(
                 [this](std::string const& error) -> void {
@@ -135,6 +192,12 @@ public:
     PageManageCheck(MainFrame* frame) : Page(frame) {
         m_status = this->addText("Checking for updates...");
         m_nextInfo = this->addText("");
+        // shown in enter if there's anything to roll back to
+        m_rollback = this->addButton(
+            "Roll back to the previous version",
+            &PageManageCheck::onRollback
+        );
+        m_rollback->Hide();
     }
 
     VersionInfo& getLoaderVersion() {
@@ -219,22 +282,25 @@ protected:
                     this->setText(m_status, "Downloading Geode CLI: " + text);
                     m_gauge->SetValue(prog);
                 },
-                [this](wxWebResponse const& wres) -> void {
-                    auto installRes = Manager::get()->installCLI(
-                        wres.GetDataFile().ToStdWstring()
+                [this](ghc::filesystem::path const& zip) -> void {
+                    this->setText(m_status, "Installing Geode CLI");
+                    Manager::get()->installCLI(
+                        zip,
+                        [this](std::string const& error) -> void {
+                            wxMessageBox(
+                                "Error updating Geode CLI: " + error + ". Try "
+                                "again, and if the problem persists, contact "
+                                "the Geode Development team for more help.",
+                                "Error Updating",
+                                wxICON_ERROR
+                            );
+                            this->setText(m_status, "Error: " + error);
+                        },
+                        [this]() -> void {
+                            Manager::get()->setCLIVersion(GET_EARLIER_PAGE(ManageCheck)->getCLIVersion());
+                            m_frame->nextPage();
+                        }
                     );
-                    if (!installRes) {
-                        wxMessageBox(
-                            "Error updating Geode CLI: " + installRes.error() + ". Try "
-                            "again, and if the problem persists, contact "
-                            "the Geode Development team for more help.",
-                            "Error Updating",
-                            wxICON_ERROR
-                        );
-                    } else {
-                        Manager::get()->setCLIVersion(GET_EARLIER_PAGE(ManageCheck)->getCLIVersion());
-                        m_frame->nextPage();
-                    }
                 }
             );
         } else {
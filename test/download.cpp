@@ -0,0 +1,563 @@
+// Runs Download against a local stand-in for a
+// download server: a segmented download whose
+// later segments finish first, falling back to a
+// single stream when the server ignores Range,
+// and resuming a cancelled download via If-Range
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    using socket_t = SOCKET;
+    #define closeSocket closesocket
+#else
+    #include <sys/socket.h>
+    #include <sys/select.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #include <csignal>
+    using socket_t = int;
+    #define INVALID_SOCKET (-1)
+    #define closeSocket close
+#endif
+
+#include "../src/Download.hpp"
+#include <wx/app.h>
+#include <wx/timer.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <thread>
+
+#define BODY_SIZE (8 * 1024 * 1024)
+#define SEND_CHUNK_SIZE (64 * 1024)
+#define TEST_TIMEOUT_MS 60000
+#define ETAG "\"geode-installer-test\""
+
+struct ServedRequest {
+    std::string m_method;
+    std::string m_range;
+    std::string m_ifRange;
+    int m_status = 0;
+    // in which order the responses were sent in full
+    size_t m_finishOrder = 0;
+};
+
+/**
+ * Serves one file over HTTP/1.1 on localhost,
+ * one connection per request. How it treats
+ * Range requests and how slowly it answers can
+ * be changed between tests
+ */
+class StandInServer {
+protected:
+    std::string m_body;
+    socket_t m_socket = INVALID_SOCKET;
+    uint16_t m_port = 0;
+    std::thread m_thread;
+    std::mutex m_lock;
+    std::vector<std::thread> m_connections;
+    std::vector<std::shared_ptr<ServedRequest>> m_requests;
+    std::atomic<bool> m_stopping = false;
+    size_t m_finished = 0;
+
+    void run();
+    void serve(socket_t client);
+    void wait(std::chrono::milliseconds time) const;
+
+public:
+    std::atomic<bool> m_honorRanges = true;
+    // how long to wait before answering a GET
+    std::atomic<int> m_delayMs = 0;
+    // wait longer for ranges closer to the start
+    // of the file, so later segments finish first
+    std::atomic<bool> m_laterRangesFirst = false;
+    // how long to wait between each sent chunk
+    std::atomic<int> m_chunkDelayMs = 0;
+    std::atomic<size_t> m_bytesSent = 0;
+
+    StandInServer(std::string const& body);
+    ~StandInServer();
+
+    bool start();
+    void stop();
+    std::string getURL() const;
+    /**
+     * Get the requests served so far and forget
+     * about them, along with the sent byte count
+     */
+    std::vector<ServedRequest> takeRequests();
+};
+
+static bool sendAll(socket_t client, char const* data, size_t size) {
+    while (size) {
+        auto sent = send(client, data, static_cast<int>(size), 0);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+static std::string toLower(std::string str) {
+    for (auto& c : str) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return str;
+}
+
+StandInServer::StandInServer(std::string const& body) : m_body(body) {}
+
+StandInServer::~StandInServer() {
+    this->stop();
+}
+
+bool StandInServer::start() {
+    m_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (m_socket == INVALID_SOCKET) {
+        return false;
+    }
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t addrSize = sizeof(addr);
+    if (
+        bind(m_socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(m_socket, 16) != 0 ||
+        getsockname(m_socket, reinterpret_cast<sockaddr*>(&addr), &addrSize) != 0
+    ) {
+        return false;
+    }
+    m_port = ntohs(addr.sin_port);
+    m_thread = std::thread(&StandInServer::run, this);
+    return true;
+}
+
+void StandInServer::stop() {
+    m_stopping = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    for (auto& connection : m_connections) {
+        if (connection.joinable()) {
+            connection.join();
+        }
+    }
+    m_connections.clear();
+    if (m_socket != INVALID_SOCKET) {
+        closeSocket(m_socket);
+        m_socket = INVALID_SOCKET;
+    }
+}
+
+std::string StandInServer::getURL() const {
+    return "http://127.0.0.1:" + std::to_string(m_port) + "/file.bin";
+}
+
+std::vector<ServedRequest> StandInServer::takeRequests() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_bytesSent = 0;
+    std::vector<ServedRequest> requests;
+    for (auto& request : m_requests) {
+        requests.push_back(*request);
+    }
+    m_requests.clear();
+    return requests;
+}
+
+void StandInServer::wait(std::chrono::milliseconds time) const {
+    auto until = std::chrono::steady_clock::now() + time;
+    while (!m_stopping && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+void StandInServer::run() {
+    while (!m_stopping) {
+        // poll so stop() doesn't have to wait
+        // for one more connection
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(m_socket, &fds);
+        timeval timeout { 0, 50 * 1000 };
+        if (select(static_cast<int>(m_socket + 1), &fds, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+        auto client = accept(m_socket, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_connections.emplace_back(&StandInServer::serve, this, client);
+    }
+}
+
+void StandInServer::serve(socket_t client) {
+    std::string head;
+    char buffer[4096];
+    while (head.find("\r\n\r\n") == std::string::npos) {
+        auto read = recv(client, buffer, sizeof(buffer), 0);
+        if (read <= 0) {
+            closeSocket(client);
+            return;
+        }
+        head.append(buffer, read);
+    }
+
+    auto request = std::make_shared<ServedRequest>();
+    request->m_method = head.substr(0, head.find(' '));
+    size_t pos = head.find("\r\n") + 2;
+    while (pos < head.size()) {
+        auto end = head.find("\r\n", pos);
+        if (end == pos) break;
+        auto line = head.substr(pos, end - pos);
+        pos = end + 2;
+        auto colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        auto key = toLower(line.substr(0, colon));
+        auto valueStart = line.find_first_not_of(' ', colon + 1);
+        auto value = valueStart == std::string::npos ? "" : line.substr(valueStart);
+        if (key == "range") {
+            request->m_range = value;
+        } else if (key == "if-range") {
+            request->m_ifRange = value;
+        }
+    }
+
+    size_t start = 0;
+    size_t end = m_body.size();
+    auto partial = false;
+    if (
+        m_honorRanges && request->m_range.rfind("bytes=", 0) == 0 &&
+        (request->m_ifRange.empty() || request->m_ifRange == ETAG)
+    ) {
+        auto spec = request->m_range.substr(6);
+        auto dash = spec.find('-');
+        start = std::stoull(spec.substr(0, dash));
+        if (dash + 1 < spec.size()) {
+            end = std::min<size_t>(std::stoull(spec.substr(dash + 1)) + 1, m_body.size());
+        }
+        partial = true;
+    }
+    request->m_status = partial ? 206 : 200;
+    // recorded before answering, as the client may
+    // be done before this thread gets to run again
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_requests.push_back(request);
+    }
+
+    std::string response = partial ?
+        "HTTP/1.1 206 Partial Content\r\n" :
+        "HTTP/1.1 200 OK\r\n";
+    response += "Content-Type: application/octet-stream\r\n";
+    response += "Content-Length: " + std::to_string(end - start) + "\r\n";
+    response += "Accept-Ranges: bytes\r\n";
+    response += "ETag: " ETAG "\r\n";
+    if (partial) {
+        response +=
+            "Content-Range: bytes " + std::to_string(start) + "-" +
+            std::to_string(end - 1) + "/" + std::to_string(m_body.size()) + "\r\n";
+    }
+    response += "Connection: close\r\n\r\n";
+
+    if (request->m_method == "GET") {
+        auto delay = m_delayMs.load();
+        if (m_laterRangesFirst) {
+            delay += static_cast<int>(
+                3.0 * delay * (m_body.size() - start) / m_body.size()
+            );
+        }
+        this->wait(std::chrono::milliseconds(delay));
+    }
+    auto ok = sendAll(client, response.data(), response.size());
+    if (request->m_method == "GET") {
+        for (auto at = start; ok && at < end && !m_stopping; at += SEND_CHUNK_SIZE) {
+            auto size = std::min<size_t>(SEND_CHUNK_SIZE, end - at);
+            if (at + size == end) {
+                std::lock_guard<std::mutex> lock(m_lock);
+                request->m_finishOrder = m_finished++;
+            }
+            m_bytesSent += size;
+            ok = sendAll(client, m_body.data() + at, size);
+            if (m_chunkDelayMs) {
+                this->wait(std::chrono::milliseconds(m_chunkDelayMs));
+            }
+        }
+    }
+    closeSocket(client);
+}
+
+static Result<> checkContents(ghc::filesystem::path const& path, std::string const& expected) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return Err("Download wasn't moved in place");
+    }
+    std::string contents(
+        (std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>()
+    );
+    if (contents != expected) {
+        return Err("Downloaded file doesn't match the served file");
+    }
+    return Ok();
+}
+
+using TestDoneFunc = std::function<void(std::string const&)>;
+using TestFunc = std::function<void(TestDoneFunc)>;
+
+class DownloadTestApp : public wxAppConsole {
+protected:
+    std::string m_body;
+    std::string m_sha256;
+    std::unique_ptr<StandInServer> m_server;
+    ghc::filesystem::path m_dir;
+    std::vector<std::pair<std::string, TestFunc>> m_tests;
+    size_t m_current = 0;
+    bool m_currentDone = false;
+    size_t m_failures = 0;
+    wxTimer m_timeout;
+
+    void addTests();
+    void runNext();
+    void finishTest(size_t index, std::string const& error);
+    ghc::filesystem::path getTarget(std::string const& name);
+
+public:
+    bool OnInit() override;
+    int OnRun() override;
+    int OnExit() override;
+};
+
+wxIMPLEMENT_APP_CONSOLE(DownloadTestApp);
+
+bool DownloadTestApp::OnInit() {
+    if (!wxAppConsole::OnInit()) return false;
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        std::cout << "Unable to initialize winsock\n";
+        return false;
+    }
+#else
+    // writing to a connection the download
+    // cancelled mustn't kill the test
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    std::mt19937 rng(1234);
+    m_body.resize(BODY_SIZE);
+    for (auto& c : m_body) {
+        c = static_cast<char>(rng());
+    }
+    Sha256 hasher;
+    hasher.update(m_body.data(), m_body.size());
+    m_sha256 = hasher.finish();
+
+    m_server = std::make_unique<StandInServer>(m_body);
+    if (!m_server->start()) {
+        std::cout << "Unable to start the stand-in server\n";
+        return false;
+    }
+
+    m_dir = ghc::filesystem::temp_directory_path() / "geode-installer-download-test";
+    std::error_code ec;
+    ghc::filesystem::remove_all(m_dir, ec);
+    ghc::filesystem::create_directories(m_dir, ec);
+
+    m_timeout.SetOwner(this);
+    this->Bind(wxEVT_TIMER, [this](wxTimerEvent&) -> void {
+        this->finishTest(m_current, "Timed out");
+    });
+
+    this->addTests();
+    this->CallAfter([this]() -> void { this->runNext(); });
+    return true;
+}
+
+int DownloadTestApp::OnRun() {
+    auto code = wxAppConsole::OnRun();
+    return m_failures ? 1 : code;
+}
+
+int DownloadTestApp::OnExit() {
+    m_server->stop();
+    std::error_code ec;
+    ghc::filesystem::remove_all(m_dir, ec);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return wxAppConsole::OnExit();
+}
+
+ghc::filesystem::path DownloadTestApp::getTarget(std::string const& name) {
+    return m_dir / name;
+}
+
+void DownloadTestApp::runNext() {
+    if (m_current >= m_tests.size()) {
+        std::cout << (m_tests.size() - m_failures) << "/" << m_tests.size() << " passed\n";
+        return this->ExitMainLoop();
+    }
+    m_currentDone = false;
+    m_server->takeRequests();
+    m_timeout.StartOnce(TEST_TIMEOUT_MS);
+    auto index = m_current;
+    m_tests.at(index).second([this, index](std::string const& error) -> void {
+        this->finishTest(index, error);
+    });
+}
+
+void DownloadTestApp::finishTest(size_t index, std::string const& error) {
+    if (index != m_current || m_currentDone) return;
+    m_currentDone = true;
+    m_timeout.Stop();
+    if (error.size()) {
+        m_failures++;
+        std::cout << "[FAIL] " << m_tests.at(index).first << ": " << error << "\n";
+    } else {
+        std::cout << "[PASS] " << m_tests.at(index).first << "\n";
+    }
+    // let whatever the download is still
+    // doing unwind before the next test
+    m_current++;
+    this->CallAfter([this]() -> void { this->runNext(); });
+}
+
+void DownloadTestApp::addTests() {
+    m_tests.push_back({ "segments finishing out of order", [this](TestDoneFunc done) -> void {
+        m_server->m_honorRanges = true;
+        m_server->m_delayMs = 100;
+        m_server->m_laterRangesFirst = true;
+        m_server->m_chunkDelayMs = 0;
+        auto target = this->getTarget("segmented.bin");
+        Download::create(
+            m_server->getURL(), target, 4,
+            done,
+            [](std::string const&, int) -> void {},
+            [this, target, done](ghc::filesystem::path const&) -> void {
+                auto res = checkContents(target, m_body);
+                if (!res) return done(res.error());
+
+                auto requests = m_server->takeRequests();
+                size_t ranged = 0;
+                size_t firstFinish = 0;
+                size_t lastFinish = 0;
+                for (auto& req : requests) {
+                    if (req.m_method != "GET") continue;
+                    if (req.m_status != 206) {
+                        return done("A segment got status " + std::to_string(req.m_status));
+                    }
+                    if (req.m_range.rfind("bytes=0-", 0) == 0) {
+                        firstFinish = req.m_finishOrder;
+                    }
+                    lastFinish = std::max(lastFinish, req.m_finishOrder);
+                    ranged++;
+                }
+                if (ranged != 4) {
+                    return done("Expected 4 segments, got " + std::to_string(ranged));
+                }
+                if (firstFinish != lastFinish) {
+                    return done("The first segment didn't finish last");
+                }
+                done("");
+            },
+            m_sha256
+        )->start();
+    } });
+
+    m_tests.push_back({ "falling back when Range is ignored", [this](TestDoneFunc done) -> void {
+        m_server->m_honorRanges = false;
+        m_server->m_delayMs = 0;
+        m_server->m_laterRangesFirst = false;
+        m_server->m_chunkDelayMs = 0;
+        auto target = this->getTarget("fallback.bin");
+        Download::create(
+            m_server->getURL(), target, 4,
+            done,
+            [](std::string const&, int) -> void {},
+            [this, target, done](ghc::filesystem::path const&) -> void {
+                auto res = checkContents(target, m_body);
+                if (!res) return done(res.error());
+
+                auto requests = m_server->takeRequests();
+                auto single = std::any_of(requests.begin(), requests.end(), [](auto const& req) {
+                    return req.m_method == "GET" && req.m_range.empty();
+                });
+                if (!single) {
+                    return done("Never fell back to a request without Range");
+                }
+                done("");
+            },
+            m_sha256
+        )->start();
+    } });
+
+    m_tests.push_back({ "resuming with If-Range", [this](TestDoneFunc done) -> void {
+        m_server->m_honorRanges = true;
+        m_server->m_delayMs = 0;
+        m_server->m_laterRangesFirst = false;
+        // slow enough to cancel halfway through
+        m_server->m_chunkDelayMs = 10;
+        auto target = this->getTarget("resumed.bin");
+        auto token = CancelToken::create();
+        Download::create(
+            m_server->getURL(), target, 4,
+            [this, target, done](std::string const& error) -> void {
+                if (error != "Cancelled") {
+                    return done("First attempt failed: " + error);
+                }
+                auto state = target;
+                state += ".part.json";
+                if (!ghc::filesystem::exists(state)) {
+                    return done("Cancelling didn't keep the progress");
+                }
+                m_server->takeRequests();
+                m_server->m_chunkDelayMs = 0;
+                this->CallAfter([this, target, done]() -> void {
+                    Download::create(
+                        m_server->getURL(), target, 4,
+                        done,
+                        [](std::string const&, int) -> void {},
+                        [this, target, done](ghc::filesystem::path const&) -> void {
+                            auto res = checkContents(target, m_body);
+                            if (!res) return done(res.error());
+
+                            size_t sent = m_server->m_bytesSent;
+                            auto requests = m_server->takeRequests();
+                            auto resumed = std::any_of(requests.begin(), requests.end(), [](auto const& req) {
+                                return req.m_method == "GET" && req.m_ifRange == ETAG && req.m_status == 206;
+                            });
+                            if (!resumed) {
+                                return done("No segment was resumed with If-Range");
+                            }
+                            if (sent >= m_body.size()) {
+                                return done("Resuming downloaded the whole file again");
+                            }
+                            done("");
+                        },
+                        m_sha256
+                    )->start();
+                });
+            },
+            [this, token](std::string const&, int progress) -> void {
+                if (progress >= 25 && !token->isCancelled()) {
+                    this->CallAfter([token]() -> void { token->cancel(); });
+                }
+            },
+            [done](ghc::filesystem::path const&) -> void {
+                done("Finished before it could be cancelled");
+            },
+            m_sha256,
+            token
+        )->start();
+    } });
+}